@@ -0,0 +1,16 @@
+#include "slider-api.h"
+#include <R_ext/Rdynload.h>
+
+int (*slider_slide_windows)(int, int, bool, int, bool, int, bool, int*, int*, int*) = NULL;
+int (*slider_index_windows)(const double*, int, double, bool, double, bool, bool, int*, int*, int*) = NULL;
+
+void (*slider_aggregate)(const struct slider_aggregator*, const double*, R_xlen_t, const int*, const int*, R_xlen_t, double*) = NULL;
+void (*slider_combine)(const struct slider_combiner*, const double*, R_xlen_t, const int*, const int*, R_xlen_t, double*) = NULL;
+
+void slider_init_api(void) {
+  slider_slide_windows = (int (*)(int, int, bool, int, bool, int, bool, int*, int*, int*)) R_GetCCallable("slider", "slider_slide_windows");
+  slider_index_windows = (int (*)(const double*, int, double, bool, double, bool, bool, int*, int*, int*)) R_GetCCallable("slider", "slider_index_windows");
+
+  slider_aggregate = (void (*)(const struct slider_aggregator*, const double*, R_xlen_t, const int*, const int*, R_xlen_t, double*)) R_GetCCallable("slider", "slider_aggregate");
+  slider_combine = (void (*)(const struct slider_combiner*, const double*, R_xlen_t, const int*, const int*, R_xlen_t, double*)) R_GetCCallable("slider", "slider_combine");
+}
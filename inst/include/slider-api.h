@@ -0,0 +1,135 @@
+#ifndef SLIDER_API_H
+#define SLIDER_API_H
+
+// The C API of slider
+//
+// Packages that want to use slider's window engine from their own C code
+// should add `LinkingTo: slider` and `Imports: slider` to their DESCRIPTION,
+// include this header, and compile `slider-api.c` once (for example, by
+// including it from one of their own `.c` files). `slider_init_api()` must be
+// called before any of the functions below are used, typically from the
+// package's `R_init_<pkg>()` function.
+//
+// All window boundaries are 1-based and inclusive, like their R level
+// counterparts, so the output of the window functions can be handed directly
+// to the kernels. Empty windows have `start = 1` and `stop = 0`.
+//
+// These functions may allocate with `R_alloc()` and signal errors with
+// `Rf_error()`, so they must be called from code running under `.Call()`.
+
+#include <R.h>
+#include <Rinternals.h>
+#include <stdbool.h>
+
+// -----------------------------------------------------------------------------
+// Native aggregators
+//
+// A native aggregator is a set of C callbacks that maintain a statistic over
+// a window of doubles as elements enter and leave the window. `state_size`
+// bytes of scratch space are allocated by slider and handed to every
+// callback, so aggregators never need to allocate themselves.
+//
+// - `init` resets `state` to an empty window.
+// - `add` / `remove` update `state` with an element entering or leaving.
+// - `finalize` computes the statistic of the current window from `state`.
+
+typedef void (*slider_aggregator_init_fn)(void* state);
+typedef void (*slider_aggregator_update_fn)(void* state, double x);
+typedef double (*slider_aggregator_finalize_fn)(const void* state);
+
+struct slider_aggregator {
+  size_t state_size;
+  slider_aggregator_init_fn init;
+  slider_aggregator_update_fn add;
+  slider_aggregator_update_fn remove;
+  slider_aggregator_finalize_fn finalize;
+};
+
+// -----------------------------------------------------------------------------
+// Native combiners
+//
+// A native combiner is an associative, but not necessarily invertible, way of
+// combining values. Each value takes up `value_size` bytes.
+//
+// - `lift` converts an element of `x` to a value.
+// - `combine` writes the combination of `a` and `b` to `out`, where `a` holds
+//   the older elements of the window. `out` never aliases `a` or `b`.
+// - `finalize` computes the statistic of a window from its combined value.
+
+typedef void (*slider_combiner_lift_fn)(void* value, double x);
+typedef void (*slider_combiner_combine_fn)(void* out, const void* a, const void* b);
+typedef double (*slider_combiner_finalize_fn)(const void* value);
+
+struct slider_combiner {
+  size_t value_size;
+  slider_combiner_lift_fn lift;
+  slider_combiner_combine_fn combine;
+  slider_combiner_finalize_fn finalize;
+};
+
+// -----------------------------------------------------------------------------
+// Window boundaries
+//
+// `slider_slide_windows()` computes the windows of `slide()` over `size`
+// elements, and `slider_index_windows()` computes the windows of
+// `slide_index()` over an ascending double index `p_i`, with one window per
+// element of `p_i`. Unbounded `before` / `after` values are requested through
+// their `*_unbounded` flags, in which case the value itself is ignored.
+//
+// `p_locs`, `p_starts`, and `p_stops` must have room for `size` elements.
+// They are filled with the 1-based output location and window boundaries of
+// each window that is evaluated, and the number of windows is returned. With
+// `step > 1` or `complete = true`, that can be fewer than `size`.
+
+extern int (*slider_slide_windows)(int size,
+                                   int before,
+                                   bool before_unbounded,
+                                   int after,
+                                   bool after_unbounded,
+                                   int step,
+                                   bool complete,
+                                   int* p_locs,
+                                   int* p_starts,
+                                   int* p_stops);
+
+extern int (*slider_index_windows)(const double* p_i,
+                                   int size,
+                                   double before,
+                                   bool before_unbounded,
+                                   double after,
+                                   bool after_unbounded,
+                                   bool complete,
+                                   int* p_locs,
+                                   int* p_starts,
+                                   int* p_stops);
+
+// -----------------------------------------------------------------------------
+// Kernels
+//
+// Run a native aggregator or combiner over the `size` windows described by
+// `p_starts` / `p_stops` into `x`, writing one result per window to `p_out`.
+// Windows that move forward, like the ones computed above, are updated
+// incrementally. Empty windows result in the finalized initial state of an
+// aggregator, and in `NA` for a combiner.
+
+extern void (*slider_aggregate)(const struct slider_aggregator* p_aggregator,
+                                const double* p_x,
+                                R_xlen_t x_size,
+                                const int* p_starts,
+                                const int* p_stops,
+                                R_xlen_t size,
+                                double* p_out);
+
+extern void (*slider_combine)(const struct slider_combiner* p_combiner,
+                              const double* p_x,
+                              R_xlen_t x_size,
+                              const int* p_starts,
+                              const int* p_stops,
+                              R_xlen_t size,
+                              double* p_out);
+
+// -----------------------------------------------------------------------------
+
+void slider_init_api(void);
+
+#endif
@@ -0,0 +1,62 @@
+#include "slider.h"
+#include "slider-vctrs.h"
+#include "utils.h"
+
+// -----------------------------------------------------------------------------
+
+// Thread a state through expanding windows of `x`. Every window starts at the
+// beginning of `x`, and `stops` are the 1-based, non-decreasing window stops.
+//
+// Rather than slicing the whole window at every iteration, only the elements
+// that entered the window since the previous call to `.f` are sliced. They are
+// bound to `.x` in `env`, alongside the current state as `.state`, so the
+// total cost of slicing is linear in the size of `x`. When no elements
+// entered the window, `.f` is not called and the state is carried forward.
+//
+// Returns a list holding the state after each window.
+
+// [[ register() ]]
+SEXP slider_accumulate_impl(SEXP x, SEXP stops, SEXP f_call, SEXP init, SEXP env) {
+  const R_xlen_t size = Rf_xlength(stops);
+  const int* p_stops = INTEGER_RO(stops);
+
+  // The indices to slice x with
+  SEXP window = PROTECT(compact_seq(0, 0, true));
+  int* p_window = INTEGER(window);
+
+  SEXP out = PROTECT(Rf_allocVector(VECSXP, size));
+
+  // `state` is always protected, either by the caller as `init`, or as the
+  // previous element of `out`
+  SEXP state = init;
+  int n_entered = 0;
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    if (i % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    const int stop = p_stops[i];
+
+    if (stop > n_entered) {
+      init_compact_seq(p_window, n_entered, stop - n_entered, true);
+
+      SEXP slice = PROTECT(vec_slice_impl(x, window));
+
+      Rf_defineVar(syms_dot_x, slice, env);
+      Rf_defineVar(syms_dot_state, state, env);
+
+      state = PROTECT(r_force_eval(f_call, env, 2));
+      SET_VECTOR_ELT(out, i, state);
+      UNPROTECT(2);
+
+      n_entered = stop;
+      continue;
+    }
+
+    SET_VECTOR_ELT(out, i, state);
+  }
+
+  UNPROTECT(2);
+  return out;
+}
@@ -0,0 +1,570 @@
+#include "slider.h"
+#include "slider-vctrs.h"
+#include "utils.h"
+#include "aggregate.h"
+
+// -----------------------------------------------------------------------------
+// Incremental aggregation
+//
+// Windows are walked in order, and the current window `[lo, hi)` is moved to
+// each target window by removing the elements that left it and adding the
+// elements that entered it. For the forward moving windows generated by
+// `slide()` and `slide_index()`, every element is added and removed at most
+// once, regardless of the window width.
+//
+// `starts` and `stops` are 1-based window boundaries, with empty windows
+// marked by `stop < start`. If a window ever moves backwards, or doesn't
+// overlap the current window at all, the state is reset and the window is
+// rebuilt from scratch, so arbitrary windows are still handled correctly.
+//
+// The walk is shared between R level and native aggregators, and the rolling
+// kernels of `slide_summarise()`, `slide_rank()`, `slide_top_k()`,
+// `slide_histogram()`, and `slide_period_quantile()`, through the small set
+// of operations in `struct aggregate_ops` on an opaque `data` pointer.
+
+// [[ include("aggregate.h") ]]
+void aggregate_walk(const int* p_starts,
+                    const int* p_stops,
+                    R_xlen_t size,
+                    bool interrupt,
+                    const struct aggregate_ops* p_ops,
+                    void* data) {
+  R_xlen_t lo = 0;
+  R_xlen_t hi = 0;
+
+  // The state starts out empty, and is only emptied again when the walk
+  // restarts with elements left in it, so `reset` isn't repeated for a state
+  // that is already empty. Without a `reset`, it is emptied by removing what
+  // is left of the window, which is never more work than adding it was.
+  if (p_ops->reset != NULL) {
+    p_ops->reset(data);
+  }
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    if (interrupt && i % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    R_xlen_t start = (R_xlen_t) p_starts[i] - 1;
+    R_xlen_t stop = (R_xlen_t) p_stops[i];
+
+    if (stop <= start) {
+      start = lo;
+      stop = lo;
+    }
+
+    if (stop == start || start >= hi || start < lo || stop < hi) {
+      if (hi > lo) {
+        if (p_ops->reset != NULL) {
+          p_ops->reset(data);
+        } else {
+          p_ops->remove(data, lo, hi);
+        }
+      }
+
+      lo = start;
+      hi = start;
+    }
+
+    if (start > lo) {
+      p_ops->remove(data, lo, start);
+      lo = start;
+    }
+
+    if (stop > hi) {
+      p_ops->add(data, hi, stop);
+      hi = stop;
+    }
+
+    p_ops->finalize(data, i, lo, hi);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// R level aggregators
+//
+// The state is an arbitrary R object held in `cell`, a list of size 1, which
+// keeps it protected across evaluations. The elements entering or leaving
+// the window are sliced out of `x` as one contiguous chunk and bound to `.x`
+// in `env`, alongside the state as `.state`.
+
+struct aggregate_r_data {
+  SEXP x;
+  SEXP window;
+  int* p_window;
+  SEXP env;
+  SEXP init_call;
+  SEXP add_call;
+  SEXP remove_call;
+  SEXP finalize_call;
+  SEXP cell;
+  SEXP out;
+};
+
+static void aggregate_r_reset(void* data) {
+  struct aggregate_r_data* p_data = (struct aggregate_r_data*) data;
+
+  SEXP state = Rf_eval(p_data->init_call, p_data->env);
+  SET_VECTOR_ELT(p_data->cell, 0, state);
+}
+
+static void aggregate_r_update(struct aggregate_r_data* p_data,
+                               SEXP call,
+                               R_xlen_t from,
+                               R_xlen_t to) {
+  init_compact_seq(p_data->p_window, from, to - from, true);
+
+  SEXP slice = PROTECT(vec_slice_impl(p_data->x, p_data->window));
+
+  Rf_defineVar(syms_dot_x, slice, p_data->env);
+  Rf_defineVar(syms_dot_state, VECTOR_ELT(p_data->cell, 0), p_data->env);
+
+  SEXP state = r_force_eval(call, p_data->env, 2);
+  SET_VECTOR_ELT(p_data->cell, 0, state);
+
+  UNPROTECT(1);
+}
+
+static void aggregate_r_add(void* data, R_xlen_t from, R_xlen_t to) {
+  struct aggregate_r_data* p_data = (struct aggregate_r_data*) data;
+  aggregate_r_update(p_data, p_data->add_call, from, to);
+}
+
+static void aggregate_r_remove(void* data, R_xlen_t from, R_xlen_t to) {
+  struct aggregate_r_data* p_data = (struct aggregate_r_data*) data;
+  aggregate_r_update(p_data, p_data->remove_call, from, to);
+}
+
+static void aggregate_r_finalize(void* data, R_xlen_t i, R_xlen_t lo, R_xlen_t hi) {
+  struct aggregate_r_data* p_data = (struct aggregate_r_data*) data;
+
+  Rf_defineVar(syms_dot_state, VECTOR_ELT(p_data->cell, 0), p_data->env);
+
+  SEXP elt = r_force_eval(p_data->finalize_call, p_data->env, 1);
+  SET_VECTOR_ELT(p_data->out, i, elt);
+}
+
+// `calls` is a list of the `init`, `add`, `remove`, and `finalize` calls,
+// which are evaluated in `env`. Returns a list of the finalized result of
+// each window.
+
+// [[ register() ]]
+SEXP slider_aggregate_r(SEXP x, SEXP starts, SEXP stops, SEXP calls, SEXP env) {
+  const R_xlen_t size = Rf_xlength(starts);
+
+  SEXP window = PROTECT(compact_seq(0, 0, true));
+  SEXP cell = PROTECT(Rf_allocVector(VECSXP, 1));
+  SEXP out = PROTECT(Rf_allocVector(VECSXP, size));
+
+  struct aggregate_r_data data = {
+    .x = x,
+    .window = window,
+    .p_window = INTEGER(window),
+    .env = env,
+    .init_call = VECTOR_ELT(calls, 0),
+    .add_call = VECTOR_ELT(calls, 1),
+    .remove_call = VECTOR_ELT(calls, 2),
+    .finalize_call = VECTOR_ELT(calls, 3),
+    .cell = cell,
+    .out = out
+  };
+
+  const struct aggregate_ops ops = {
+    .reset = aggregate_r_reset,
+    .add = aggregate_r_add,
+    .remove = aggregate_r_remove,
+    .finalize = aggregate_r_finalize
+  };
+
+  aggregate_walk(INTEGER_RO(starts), INTEGER_RO(stops), size, true, &ops, &data);
+
+  UNPROTECT(3);
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+// Native aggregators
+//
+// Native aggregators never touch the R API, the state lives in `state_size`
+// bytes of scratch memory, and the elements are fed to `add` / `remove` one
+// at a time.
+
+struct aggregate_native_data {
+  const struct slider_aggregator* p_aggregator;
+  const double* p_x;
+  void* state;
+  double* p_out;
+};
+
+static void aggregate_native_reset(void* data) {
+  struct aggregate_native_data* p_data = (struct aggregate_native_data*) data;
+  p_data->p_aggregator->init(p_data->state);
+}
+
+static void aggregate_native_add(void* data, R_xlen_t from, R_xlen_t to) {
+  struct aggregate_native_data* p_data = (struct aggregate_native_data*) data;
+
+  const slider_aggregator_update_fn add = p_data->p_aggregator->add;
+  void* state = p_data->state;
+
+  for (R_xlen_t j = from; j < to; ++j) {
+    add(state, p_data->p_x[j]);
+  }
+}
+
+static void aggregate_native_remove(void* data, R_xlen_t from, R_xlen_t to) {
+  struct aggregate_native_data* p_data = (struct aggregate_native_data*) data;
+
+  const slider_aggregator_update_fn remove = p_data->p_aggregator->remove;
+  void* state = p_data->state;
+
+  for (R_xlen_t j = from; j < to; ++j) {
+    remove(state, p_data->p_x[j]);
+  }
+}
+
+static void aggregate_native_finalize(void* data, R_xlen_t i, R_xlen_t lo, R_xlen_t hi) {
+  struct aggregate_native_data* p_data = (struct aggregate_native_data*) data;
+  p_data->p_out[i] = p_data->p_aggregator->finalize(p_data->state);
+}
+
+// `state` is `state_size` bytes of scratch memory owned by the caller. With
+// `interrupt = false` this never touches the R API, so independent walks can
+// run concurrently, each with its own `state`.
+void aggregate_native_walk(const struct slider_aggregator* p_aggregator,
+                           const double* p_x,
+                           const int* p_starts,
+                           const int* p_stops,
+                           R_xlen_t size,
+                           void* state,
+                           bool interrupt,
+                           double* p_out) {
+  struct aggregate_native_data data = {
+    .p_aggregator = p_aggregator,
+    .p_x = p_x,
+    .state = state,
+    .p_out = p_out
+  };
+
+  const struct aggregate_ops ops = {
+    .reset = aggregate_native_reset,
+    .add = aggregate_native_add,
+    .remove = aggregate_native_remove,
+    .finalize = aggregate_native_finalize
+  };
+
+  aggregate_walk(p_starts, p_stops, size, interrupt, &ops, &data);
+}
+
+void aggregate_native(const struct slider_aggregator* p_aggregator,
+                      const double* p_x,
+                      const int* p_starts,
+                      const int* p_stops,
+                      R_xlen_t size,
+                      double* p_out) {
+  aggregate_native_walk(
+    p_aggregator,
+    p_x,
+    p_starts,
+    p_stops,
+    size,
+    R_alloc(p_aggregator->state_size, 1),
+    true,
+    p_out
+  );
+}
+
+// [[ register() ]]
+SEXP slider_aggregate_native(SEXP x, SEXP starts, SEXP stops, SEXP pointer) {
+  const R_xlen_t size = Rf_xlength(starts);
+  const struct slider_aggregator* p_aggregator = slider_aggregator_deref(pointer);
+
+  SEXP out = PROTECT(Rf_allocVector(REALSXP, size));
+
+  aggregate_native(
+    p_aggregator,
+    REAL_RO(x),
+    INTEGER_RO(starts),
+    INTEGER_RO(stops),
+    size,
+    REAL(out)
+  );
+
+  UNPROTECT(1);
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+// Weighted aggregation
+//
+// The built-in weighted kernels take a value `x` and a weight `w` per
+// element, and keep running sums of `w`, `w^2`, `w * x`, and `w * x^2` as
+// elements enter and leave the window. Like `weighted.mean()`, elements with
+// a zero weight are dropped entirely, even when `x` is missing, while a
+// missing weight, or a missing `x` with a nonzero weight, makes the result
+// `NA`. Non-finite values are counted rather than added, so they don't
+// poison the running sums. The sums are taken around the first value added
+// since the window was last empty, which keeps `w * x^2` from cancelling
+// catastrophically when the values are far from zero.
+
+enum weighted_stat {
+  WEIGHTED_STAT_MEAN = 0,
+  WEIGHTED_STAT_VAR = 1
+};
+
+struct weighted_state {
+  long double sum_w;
+  long double sum_ww;
+  long double sum_wx;
+  long double sum_wxx;
+  long double sum_w_inf;
+  double shift;
+  R_xlen_t n;
+  R_xlen_t n_missing;
+  R_xlen_t n_nan;
+  R_xlen_t n_pos_inf;
+  R_xlen_t n_neg_inf;
+};
+
+struct aggregate_weighted_data {
+  const double* p_x;
+  const double* p_w;
+  enum weighted_stat stat;
+  struct weighted_state state;
+  double* p_out;
+};
+
+static void weighted_state_init(struct weighted_state* p_state) {
+  p_state->sum_w = 0;
+  p_state->sum_ww = 0;
+  p_state->sum_wx = 0;
+  p_state->sum_wxx = 0;
+  p_state->sum_w_inf = 0;
+  p_state->shift = NA_REAL;
+  p_state->n = 0;
+  p_state->n_missing = 0;
+  p_state->n_nan = 0;
+  p_state->n_pos_inf = 0;
+  p_state->n_neg_inf = 0;
+}
+
+// `delta` is `1` to add the element and `-1` to remove it
+static inline void weighted_state_update(struct weighted_state* p_state,
+                                         double x,
+                                         double w,
+                                         int delta) {
+  if (w == 0) {
+    return;
+  }
+  if (ISNAN(w) || ISNAN(x)) {
+    p_state->n_missing += delta;
+    return;
+  }
+  if (!R_FINITE(w)) {
+    p_state->n_nan += delta;
+    return;
+  }
+  if (!R_FINITE(x)) {
+    if ((x > 0) == (w > 0)) {
+      p_state->n_pos_inf += delta;
+    } else {
+      p_state->n_neg_inf += delta;
+    }
+    p_state->sum_w_inf += delta * (long double) w;
+    return;
+  }
+
+  if (ISNAN(p_state->shift)) {
+    p_state->shift = x;
+  }
+
+  const long double dx = (long double) x - p_state->shift;
+  const long double wx = w * dx;
+
+  p_state->sum_w += delta * (long double) w;
+  p_state->sum_ww += delta * (long double) w * w;
+  p_state->sum_wx += delta * wx;
+  p_state->sum_wxx += delta * wx * dx;
+  p_state->n += delta;
+
+  // Start over from exact zeros, and a new shift, once the window is empty
+  if (p_state->n == 0) {
+    p_state->sum_w = 0;
+    p_state->sum_ww = 0;
+    p_state->sum_wx = 0;
+    p_state->sum_wxx = 0;
+    p_state->shift = NA_REAL;
+  }
+}
+
+static double weighted_state_mean(const struct weighted_state* p_state) {
+  if (p_state->n_missing != 0) {
+    return NA_REAL;
+  }
+  if (p_state->n_nan != 0 || (p_state->n_pos_inf != 0 && p_state->n_neg_inf != 0)) {
+    return R_NaN;
+  }
+  if (p_state->n_pos_inf != 0 || p_state->n_neg_inf != 0) {
+    // The sign of the result also depends on the sign of the total weight
+    const double inf = p_state->n_pos_inf != 0 ? R_PosInf : R_NegInf;
+    return inf / (double) (p_state->sum_w + p_state->sum_w_inf);
+  }
+  if (p_state->n == 0 || p_state->sum_w == 0) {
+    return R_NaN;
+  }
+
+  return (double) (p_state->shift + p_state->sum_wx / p_state->sum_w);
+}
+
+// The unbiased variance for reliability weights, which is `var(x)` when all
+// of the weights are equal
+static double weighted_state_var(const struct weighted_state* p_state) {
+  if (p_state->n_missing != 0) {
+    return NA_REAL;
+  }
+  if (p_state->n_nan != 0 || p_state->n_pos_inf != 0 || p_state->n_neg_inf != 0) {
+    return R_NaN;
+  }
+  if (p_state->n < 2) {
+    return NA_REAL;
+  }
+
+  const long double sum_w = p_state->sum_w;
+  const long double denominator = sum_w - p_state->sum_ww / sum_w;
+
+  if (sum_w == 0 || denominator == 0) {
+    return R_NaN;
+  }
+
+  long double numerator = p_state->sum_wxx - p_state->sum_wx * p_state->sum_wx / sum_w;
+
+  // Rounding can make the sum of squares slightly negative when all of the
+  // values in the window are equal
+  if (numerator < 0) {
+    numerator = 0;
+  }
+
+  return (double) (numerator / denominator);
+}
+
+static void aggregate_weighted_reset(void* data) {
+  struct aggregate_weighted_data* p_data = (struct aggregate_weighted_data*) data;
+  weighted_state_init(&p_data->state);
+}
+
+static void aggregate_weighted_add(void* data, R_xlen_t from, R_xlen_t to) {
+  struct aggregate_weighted_data* p_data = (struct aggregate_weighted_data*) data;
+
+  for (R_xlen_t j = from; j < to; ++j) {
+    weighted_state_update(&p_data->state, p_data->p_x[j], p_data->p_w[j], 1);
+  }
+}
+
+static void aggregate_weighted_remove(void* data, R_xlen_t from, R_xlen_t to) {
+  struct aggregate_weighted_data* p_data = (struct aggregate_weighted_data*) data;
+
+  for (R_xlen_t j = from; j < to; ++j) {
+    weighted_state_update(&p_data->state, p_data->p_x[j], p_data->p_w[j], -1);
+  }
+}
+
+static void aggregate_weighted_finalize(void* data, R_xlen_t i, R_xlen_t lo, R_xlen_t hi) {
+  struct aggregate_weighted_data* p_data = (struct aggregate_weighted_data*) data;
+
+  switch (p_data->stat) {
+  case WEIGHTED_STAT_MEAN: p_data->p_out[i] = weighted_state_mean(&p_data->state); break;
+  case WEIGHTED_STAT_VAR: p_data->p_out[i] = weighted_state_var(&p_data->state); break;
+  }
+}
+
+// `x` and `w` are double vectors of the same size, and `stat` is the
+// `weighted_stat` to compute. Returns a double vector of the result of each
+// window.
+
+// [[ register() ]]
+SEXP slider_aggregate_weighted(SEXP x, SEXP w, SEXP starts, SEXP stops, SEXP stat) {
+  const R_xlen_t size = Rf_xlength(starts);
+
+  SEXP out = PROTECT(Rf_allocVector(REALSXP, size));
+
+  struct aggregate_weighted_data data = {
+    .p_x = REAL_RO(x),
+    .p_w = REAL_RO(w),
+    .stat = (enum weighted_stat) r_scalar_int_get(stat),
+    .p_out = REAL(out)
+  };
+
+  const struct aggregate_ops ops = {
+    .reset = aggregate_weighted_reset,
+    .add = aggregate_weighted_add,
+    .remove = aggregate_weighted_remove,
+    .finalize = aggregate_weighted_finalize
+  };
+
+  aggregate_walk(INTEGER_RO(starts), INTEGER_RO(stops), size, true, &ops, &data);
+
+  UNPROTECT(1);
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
+static void aggregator_finalizer(SEXP pointer) {
+  struct slider_aggregator* p_aggregator = R_ExternalPtrAddr(pointer);
+
+  if (p_aggregator == NULL) {
+    return;
+  }
+
+  R_Free(p_aggregator);
+  R_ClearExternalPtr(pointer);
+}
+
+// Look up the callbacks of a native aggregator registered by `package` with
+// `R_RegisterCCallable()`. `names` holds the names of the `init`, `add`,
+// `remove`, and `finalize` callables. `R_GetCCallable()` errors if a
+// callable hasn't been registered.
+
+// [[ register() ]]
+SEXP slider_new_aggregator_native(SEXP package, SEXP names, SEXP state_size) {
+  const char* c_package = r_scalar_chr_get(package);
+
+  slider_aggregator_init_fn init =
+    (slider_aggregator_init_fn) R_GetCCallable(c_package, CHAR(STRING_ELT(names, 0)));
+  slider_aggregator_update_fn add =
+    (slider_aggregator_update_fn) R_GetCCallable(c_package, CHAR(STRING_ELT(names, 1)));
+  slider_aggregator_update_fn remove =
+    (slider_aggregator_update_fn) R_GetCCallable(c_package, CHAR(STRING_ELT(names, 2)));
+  slider_aggregator_finalize_fn finalize =
+    (slider_aggregator_finalize_fn) R_GetCCallable(c_package, CHAR(STRING_ELT(names, 3)));
+
+  struct slider_aggregator* p_aggregator = R_Calloc(1, struct slider_aggregator);
+
+  p_aggregator->state_size = (size_t) r_scalar_int_get(state_size);
+  p_aggregator->init = init;
+  p_aggregator->add = add;
+  p_aggregator->remove = remove;
+  p_aggregator->finalize = finalize;
+
+  SEXP out = PROTECT(R_MakeExternalPtr(p_aggregator, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(out, aggregator_finalizer, TRUE);
+
+  UNPROTECT(1);
+  return out;
+}
+
+// External pointers don't survive serialization, so an aggregator that was
+// saved and reloaded has a `NULL` address
+struct slider_aggregator* slider_aggregator_deref(SEXP pointer) {
+  struct slider_aggregator* p_aggregator = R_ExternalPtrAddr(pointer);
+
+  if (p_aggregator == NULL) {
+    Rf_errorcall(
+      R_NilValue,
+      "This native aggregator is no longer valid. "
+      "Native aggregators can't be saved and reloaded, recreate it instead."
+    );
+  }
+
+  return p_aggregator;
+}
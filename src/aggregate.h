@@ -0,0 +1,89 @@
+#ifndef SLIDER_AGGREGATE_H
+#define SLIDER_AGGREGATE_H
+
+#include "slider.h"
+
+// The native aggregator and combiner structs are part of the C API
+#include <slider-api.h>
+
+// -----------------------------------------------------------------------------
+// Incremental window walk
+//
+// `aggregate_walk()` moves the window `[lo, hi)` through the 1-based
+// `[starts, stops]` windows in order, calling `add` and `remove` with the
+// 0-based ranges of elements that enter and leave it, and then `finalize`
+// with the 0-based index of the window and its current range. The state is
+// emptied with `reset` whenever the walk restarts, or, when `reset` is
+// `NULL`, by removing what is left of the window.
+
+struct aggregate_ops {
+  void (*reset)(void* data);
+  void (*add)(void* data, R_xlen_t from, R_xlen_t to);
+  void (*remove)(void* data, R_xlen_t from, R_xlen_t to);
+  void (*finalize)(void* data, R_xlen_t i, R_xlen_t lo, R_xlen_t hi);
+};
+
+void aggregate_walk(const int* p_starts,
+                    const int* p_stops,
+                    R_xlen_t size,
+                    bool interrupt,
+                    const struct aggregate_ops* p_ops,
+                    void* data);
+
+// The 1-based output locations of window `i`, where `loc` holds either one
+// location per window, or a list of locations per window when a window is
+// shared by several of them, as with `slide_index()`
+static inline const int* aggregate_loc(SEXP loc, R_xlen_t i, R_xlen_t* p_n) {
+  if (TYPEOF(loc) == INTSXP) {
+    *p_n = 1;
+    return INTEGER_RO(loc) + i;
+  }
+
+  SEXP locs = VECTOR_ELT(loc, i);
+  *p_n = Rf_xlength(locs);
+  return INTEGER_RO(locs);
+}
+
+// -----------------------------------------------------------------------------
+
+struct slider_aggregator* slider_aggregator_deref(SEXP pointer);
+struct slider_combiner* slider_combiner_deref(SEXP pointer);
+
+void aggregate_native(const struct slider_aggregator* p_aggregator,
+                      const double* p_x,
+                      const int* p_starts,
+                      const int* p_stops,
+                      R_xlen_t size,
+                      double* p_out);
+
+void aggregate_native_walk(const struct slider_aggregator* p_aggregator,
+                           const double* p_x,
+                           const int* p_starts,
+                           const int* p_stops,
+                           R_xlen_t size,
+                           void* state,
+                           bool interrupt,
+                           double* p_out);
+
+void combine_native(const struct slider_combiner* p_combiner,
+                    const double* p_x,
+                    const int* p_starts,
+                    const int* p_stops,
+                    R_xlen_t size,
+                    double* p_out);
+
+R_xlen_t combine_max_width(const int* p_starts, const int* p_stops, R_xlen_t size);
+
+size_t combine_native_buffer_size(const struct slider_combiner* p_combiner, R_xlen_t width);
+
+void combine_native_walk(const struct slider_combiner* p_combiner,
+                         const double* p_x,
+                         R_xlen_t width,
+                         const int* p_starts,
+                         const int* p_stops,
+                         R_xlen_t size,
+                         void* buffer,
+                         bool interrupt,
+                         double* p_out);
+
+#endif
@@ -0,0 +1,202 @@
+#include "slider.h"
+#include "utils.h"
+#include "params.h"
+#include "window.h"
+#include "aggregate.h"
+
+// -----------------------------------------------------------------------------
+// C API
+//
+// These are registered as C callables in `R_init_slider()`, and are declared
+// for other packages in `inst/include/slider-api.h`. They work on raw
+// pointers and C values only, so they never allocate R objects. Invalid
+// input is still reported through R errors, as the callers are expected to
+// be running under `.Call()`.
+
+// [[ callable() ]]
+int api_slide_windows(int size,
+                      int before,
+                      bool before_unbounded,
+                      int after,
+                      bool after_unbounded,
+                      int step,
+                      bool complete,
+                      int* p_locs,
+                      int* p_starts,
+                      int* p_stops) {
+  if (size < 0) {
+    Rf_errorcall(R_NilValue, "`size` can't be negative, not %i.", size);
+  }
+
+  struct slide_info info;
+
+  enum window_status status = slide_info_compute(
+    &info,
+    size,
+    before,
+    before_unbounded,
+    after,
+    after_unbounded,
+    step,
+    complete
+  );
+
+  if (status != WINDOW_OK) {
+    stop_window_status(status, before, after, step);
+  }
+
+  return slide_info_fill_windows(info, size, p_locs, p_starts, p_stops);
+}
+
+// -----------------------------------------------------------------------------
+
+static void check_index(const double* p_i, int size) {
+  for (int k = 0; k < size; ++k) {
+    if (ISNAN(p_i[k])) {
+      Rf_errorcall(R_NilValue, "`i` can't be missing, but location %i is missing.", k + 1);
+    }
+    if (k > 0 && p_i[k] < p_i[k - 1]) {
+      Rf_errorcall(R_NilValue, "`i` must be in ascending order, but location %i is not.", k + 1);
+    }
+  }
+}
+
+// The window boundaries are `i - before` and `i + after`, which are computed
+// on the fly while `window_locate()` compares them with the index, so no
+// memory is needed for them. `y` is the `struct index_bound` of the
+// boundary.
+struct index_bound {
+  const double* p_i;
+  double offset;
+};
+
+static int index_bound_compare(const void* x, int i, const void* y, int j) {
+  const struct index_bound* p_bound = (const struct index_bound*) y;
+
+  const double lhs = ((const double*) x)[i];
+  const double rhs = p_bound->p_i[j] + p_bound->offset;
+
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+// [[ callable() ]]
+int api_index_windows(const double* p_i,
+                      int size,
+                      double before,
+                      bool before_unbounded,
+                      double after,
+                      bool after_unbounded,
+                      bool complete,
+                      int* p_locs,
+                      int* p_starts,
+                      int* p_stops) {
+  if (size < 0) {
+    Rf_errorcall(R_NilValue, "`size` can't be negative, not %i.", size);
+  }
+  if (!before_unbounded && ISNAN(before)) {
+    Rf_errorcall(R_NilValue, "`.before` can't be missing.");
+  }
+  if (!after_unbounded && ISNAN(after)) {
+    Rf_errorcall(R_NilValue, "`.after` can't be missing.");
+  }
+  if (!before_unbounded && !after_unbounded && after < -before) {
+    Rf_errorcall(
+      R_NilValue,
+      "The window computed from `.before` (%g) and `.after` (%g) can't stop before it starts.",
+      before,
+      after
+    );
+  }
+
+  check_index(p_i, size);
+
+  if (size == 0) {
+    return 0;
+  }
+
+  const struct index_bound starts = { p_i, -before };
+  const struct index_bound stops = { p_i, after };
+
+  struct window_index index = new_window_index(p_i, size, index_bound_compare);
+
+  const struct window_range range = new_window_range(
+    before_unbounded ? NULL : &starts,
+    after_unbounded ? NULL : &stops,
+    size
+  );
+
+  const int iteration_min = window_min_iteration(index, range, complete);
+  const int iteration_max = window_max_iteration(index, range, complete);
+
+  int n = 0;
+
+  for (int k = iteration_min; k < iteration_max; ++k) {
+    int start;
+    int stop;
+
+    window_locate(&index, range, k, &start, &stop);
+
+    if (stop < start) {
+      start = 0;
+      stop = -1;
+    }
+
+    p_locs[n] = k + 1;
+    p_starts[n] = start + 1;
+    p_stops[n] = stop + 1;
+    ++n;
+  }
+
+  return n;
+}
+
+// -----------------------------------------------------------------------------
+
+static void check_windows(R_xlen_t x_size,
+                          const int* p_starts,
+                          const int* p_stops,
+                          R_xlen_t size) {
+  for (R_xlen_t i = 0; i < size; ++i) {
+    const int start = p_starts[i];
+    const int stop = p_stops[i];
+
+    if (stop < start) {
+      continue;
+    }
+
+    if (start < 1 || stop > x_size) {
+      Rf_errorcall(
+        R_NilValue,
+        "Window %lld, from %i to %i, is out of bounds for `x` of size %lld.",
+        (long long) i + 1,
+        start,
+        stop,
+        (long long) x_size
+      );
+    }
+  }
+}
+
+// [[ callable() ]]
+void api_aggregate(const struct slider_aggregator* p_aggregator,
+                   const double* p_x,
+                   R_xlen_t x_size,
+                   const int* p_starts,
+                   const int* p_stops,
+                   R_xlen_t size,
+                   double* p_out) {
+  check_windows(x_size, p_starts, p_stops, size);
+  aggregate_native(p_aggregator, p_x, p_starts, p_stops, size, p_out);
+}
+
+// [[ callable() ]]
+void api_combine(const struct slider_combiner* p_combiner,
+                 const double* p_x,
+                 R_xlen_t x_size,
+                 const int* p_starts,
+                 const int* p_stops,
+                 R_xlen_t size,
+                 double* p_out) {
+  check_windows(x_size, p_starts, p_stops, size);
+  combine_native(p_combiner, p_x, p_starts, p_stops, size, p_out);
+}
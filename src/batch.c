@@ -0,0 +1,57 @@
+#include "slider.h"
+#include "utils.h"
+
+// -----------------------------------------------------------------------------
+
+#define BATCH_MATRIX_COPY(CTYPE, CONST_DEREF, DEREF) do {         \
+  const CTYPE* p_x = CONST_DEREF(x);                              \
+  CTYPE* p_out = DEREF(out);                                      \
+                                                                  \
+  for (R_xlen_t j = 0; j < n; ++j) {                              \
+    const CTYPE* p_src = p_x + p_starts[j] - 1;                   \
+    memcpy(p_out, p_src, width_ * sizeof(CTYPE));                 \
+    p_out += width_;                                              \
+  }                                                               \
+} while (0)
+
+// Build a `width x length(starts)` matrix with one window per column, where
+// column `j` holds `x[starts[j]:(starts[j] + width - 1)]`. This is the strided
+// representation of a batch of fixed width windows. Every window is assumed to
+// be fully contained in `x`.
+
+// [[ export() ]]
+SEXP slider_batch_matrix(SEXP x, SEXP starts, SEXP width) {
+  const R_xlen_t n = Rf_xlength(starts);
+  const int width_ = r_scalar_int_get(width);
+  const int* p_starts = INTEGER_RO(starts);
+
+  const SEXPTYPE type = TYPEOF(x);
+
+  SEXP out = PROTECT(Rf_allocMatrix(type, width_, n));
+
+  switch (type) {
+  case LGLSXP: BATCH_MATRIX_COPY(int, LOGICAL_RO, LOGICAL); break;
+  case INTSXP: BATCH_MATRIX_COPY(int, INTEGER_RO, INTEGER); break;
+  case REALSXP: BATCH_MATRIX_COPY(double, REAL_RO, REAL); break;
+  case STRSXP: {
+    const SEXP* p_x = STRING_PTR_RO(x);
+    R_xlen_t loc = 0;
+
+    for (R_xlen_t j = 0; j < n; ++j) {
+      const SEXP* p_src = p_x + p_starts[j] - 1;
+
+      for (int k = 0; k < width_; ++k, ++loc) {
+        SET_STRING_ELT(out, loc, p_src[k]);
+      }
+    }
+
+    break;
+  }
+  default: Rf_errorcall(R_NilValue, "Internal error: Unsupported type in `slider_batch_matrix()`.");
+  }
+
+  UNPROTECT(1);
+  return out;
+}
+
+#undef BATCH_MATRIX_COPY
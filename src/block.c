@@ -1,26 +1,244 @@
 #include "slider.h"
 #include "slider-vctrs.h"
+#include "utils.h"
+#include "summary.h"
+
+// -----------------------------------------------------------------------------
+
+static SEXP block_eager(SEXP x, const int* p_starts, const int* p_stops, R_xlen_t size);
+static SEXP block_lazy(SEXP x, SEXP starts, SEXP stops);
 
 // [[ export() ]]
-SEXP slider_block(SEXP x, SEXP starts, SEXP stops) {
+SEXP slider_block(SEXP x, SEXP starts, SEXP stops, SEXP lazy) {
   R_xlen_t size = Rf_xlength(starts);
 
-  double* p_starts = REAL(starts);
-  double* p_stops = REAL(stops);
+  const double* p_boundary_starts = REAL_RO(starts);
+  const double* p_boundary_stops = REAL_RO(stops);
+
+  // The boundaries are stored as 0-based int arrays, which is all that a
+  // lazy block list needs to hold on to in addition to `x`
+  SEXP starts_ = PROTECT(Rf_allocVector(INTSXP, size));
+  SEXP stops_ = PROTECT(Rf_allocVector(INTSXP, size));
 
+  int* p_starts = INTEGER(starts_);
+  int* p_stops = INTEGER(stops_);
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    p_starts[i] = (int) p_boundary_starts[i] - 1;
+    p_stops[i] = (int) p_boundary_stops[i] - 1;
+  }
+
+  SEXP out;
+
+  if (r_scalar_lgl_get(lazy) && SLIDER_HAS_ALTLIST) {
+    out = block_lazy(x, starts_, stops_);
+  } else {
+    out = block_eager(x, p_starts, p_stops, size);
+  }
+
+  UNPROTECT(2);
+  return out;
+}
+
+static SEXP block_eager(SEXP x, const int* p_starts, const int* p_stops, R_xlen_t size) {
   SEXP indices = PROTECT(Rf_allocVector(VECSXP, size));
 
   for (R_xlen_t i = 0; i < size; ++i) {
     int start = p_starts[i];
-    int stop = p_stops[i];
-    int size = stop - start + 1;
+    int size = p_stops[i] - start + 1;
 
-    SEXP seq = compact_seq(start - 1, size, true);
+    SEXP seq = compact_seq(start, size, true);
     SET_VECTOR_ELT(indices, i, seq);
   }
 
-  SEXP out = PROTECT(vec_chop(x, indices));
+  SEXP out = vec_chop(x, indices);
+
+  UNPROTECT(1);
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
+// Summarise each block of `x` without chopping it. `starts` and `stops` are
+// the 1-based double boundaries straight from `warp_boundary()`, and `stats`
+// are the 0-based codes of the requested statistics. Every block is
+// summarised in a single pass over its elements, and no per-block vectors
+// are allocated, so the blocks can be summarised in parallel.
+
+// [[ export() ]]
+SEXP slider_block_summarise(SEXP x,
+                            SEXP starts,
+                            SEXP stops,
+                            SEXP stats,
+                            SEXP na_rm,
+                            SEXP parallel) {
+  int n_prot = 0;
+
+  const R_xlen_t size = Rf_xlength(starts);
+  const bool na_rm_ = r_scalar_lgl_get(na_rm);
+  const bool parallel_ = r_scalar_lgl_get(parallel);
+
+  const double* p_x = REAL_RO(x);
+  const double* p_starts = REAL_RO(starts);
+  const double* p_stops = REAL_RO(stops);
+
+  struct summary_cols cols = new_summary_cols(stats, size);
+  PROTECT_SUMMARY_COLS(&cols, &n_prot);
+
+  #pragma omp parallel for if (parallel_) schedule(static)
+  for (R_xlen_t i = 0; i < size; ++i) {
+    struct summary summary;
+
+    const R_xlen_t start = (R_xlen_t) p_starts[i] - 1;
+    const R_xlen_t stop = (R_xlen_t) p_stops[i] - 1;
+
+    summary_range(p_x, start, stop, na_rm_, &summary);
+    summary_cols_assign(cols, i, &summary);
+  }
+
+  UNPROTECT(n_prot);
+  return cols.data;
+}
+
+// -----------------------------------------------------------------------------
+// Lazy block lists
+//
+// A lazy block list is an ALTREP list that holds on to `x` and the block
+// boundaries, and only slices a block out of `x` when that element is
+// accessed. Slices are cached in `data2` so repeated access doesn't
+// repeatedly slice, and so that modified elements stick.
+//
+// - `data1` is `list(x, starts, stops)`
+// - `data2` is a list the same size as the output, with `NULL` for elements
+//   that have not been materialized yet
+//
+// ALTREP lists were only added in R 4.3.0. On older versions of R we always
+// fall back to eagerly chopping `x`.
+
+#if SLIDER_HAS_ALTLIST
+
+#include <R_ext/Altrep.h>
+
+static R_altrep_class_t block_list_class;
+
+static inline SEXP block_list_x(SEXP x) {
+  return VECTOR_ELT(R_altrep_data1(x), 0);
+}
+static inline const int* block_list_starts(SEXP x) {
+  return INTEGER_RO(VECTOR_ELT(R_altrep_data1(x), 1));
+}
+static inline const int* block_list_stops(SEXP x) {
+  return INTEGER_RO(VECTOR_ELT(R_altrep_data1(x), 2));
+}
+static inline SEXP block_list_cache(SEXP x) {
+  return R_altrep_data2(x);
+}
+
+static SEXP block_lazy(SEXP x, SEXP starts, SEXP stops) {
+  R_xlen_t size = Rf_xlength(starts);
+
+  SEXP data1 = PROTECT(Rf_allocVector(VECSXP, 3));
+  SET_VECTOR_ELT(data1, 0, x);
+  SET_VECTOR_ELT(data1, 1, starts);
+  SET_VECTOR_ELT(data1, 2, stops);
+
+  SEXP cache = PROTECT(Rf_allocVector(VECSXP, size));
+
+  SEXP out = R_new_altrep(block_list_class, data1, cache);
 
   UNPROTECT(2);
   return out;
 }
+
+static SEXP block_list_materialize_elt(SEXP x, R_xlen_t i) {
+  SEXP cache = block_list_cache(x);
+  SEXP elt = VECTOR_ELT(cache, i);
+
+  if (elt != R_NilValue) {
+    return elt;
+  }
+
+  int start = block_list_starts(x)[i];
+  int size = block_list_stops(x)[i] - start + 1;
+
+  SEXP seq = PROTECT(compact_seq(start, size, true));
+  elt = PROTECT(vec_slice_impl(block_list_x(x), seq));
+
+  SET_VECTOR_ELT(cache, i, elt);
+
+  UNPROTECT(2);
+  return elt;
+}
+
+static R_xlen_t block_list_length(SEXP x) {
+  return Rf_xlength(block_list_cache(x));
+}
+
+static SEXP block_list_elt(SEXP x, R_xlen_t i) {
+  return block_list_materialize_elt(x, i);
+}
+
+static void block_list_set_elt(SEXP x, R_xlen_t i, SEXP value) {
+  SET_VECTOR_ELT(block_list_cache(x), i, value);
+}
+
+// Requesting the data pointer forces every block to be materialized
+static void* block_list_dataptr(SEXP x, Rboolean writeable) {
+  R_xlen_t size = block_list_length(x);
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    block_list_materialize_elt(x, i);
+  }
+
+  return DATAPTR(block_list_cache(x));
+}
+
+static const void* block_list_dataptr_or_null(SEXP x) {
+  return NULL;
+}
+
+static Rboolean block_list_inspect(SEXP x,
+                                   int pre,
+                                   int deep,
+                                   int pvec,
+                                   void (*inspect_subtree)(SEXP, int, int, int)) {
+  SEXP cache = block_list_cache(x);
+  R_xlen_t size = Rf_xlength(cache);
+  R_xlen_t n_materialized = 0;
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    n_materialized += VECTOR_ELT(cache, i) != R_NilValue;
+  }
+
+  Rprintf(
+    "slider_block_list (size = %lld, materialized = %lld)\n",
+    (long long) size,
+    (long long) n_materialized
+  );
+
+  return TRUE;
+}
+
+// [[ register() ]]
+void slider_initialize_block(DllInfo* dll) {
+  block_list_class = R_make_altlist_class("slider_block_list", "slider", dll);
+
+  R_set_altrep_Length_method(block_list_class, block_list_length);
+  R_set_altrep_Inspect_method(block_list_class, block_list_inspect);
+  R_set_altvec_Dataptr_method(block_list_class, block_list_dataptr);
+  R_set_altvec_Dataptr_or_null_method(block_list_class, block_list_dataptr_or_null);
+  R_set_altlist_Elt_method(block_list_class, block_list_elt);
+  R_set_altlist_Set_elt_method(block_list_class, block_list_set_elt);
+}
+
+#else
+
+static SEXP block_lazy(SEXP x, SEXP starts, SEXP stops) {
+  never_reached("block_lazy");
+}
+
+// [[ register() ]]
+void slider_initialize_block(DllInfo* dll) {
+}
+
+#endif
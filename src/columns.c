@@ -0,0 +1,157 @@
+#include "slider.h"
+#include "utils.h"
+#include "aggregate.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Column batched kernels
+//
+// Every column of `x` is walked over the same windows, so the boundaries are
+// computed once by the caller and shared. `x` is a double matrix, stored
+// column major, so each walk streams through one contiguous column.
+//
+// The native walks never touch the R API when `interrupt = false`, so with
+// OpenMP the columns can be split into contiguous blocks, one per thread. All
+// scratch memory is allocated up front, with one slot per thread.
+
+struct columns_info {
+  const double* p_x;
+  R_xlen_t x_size;
+  int n_cols;
+  const int* p_loc;
+  const int* p_starts;
+  const int* p_stops;
+  R_xlen_t size;
+  const struct slider_aggregator* p_aggregator;
+  const struct slider_combiner* p_combiner;
+  R_xlen_t width;
+  size_t scratch_size;
+  double* p_out;
+};
+
+static void columns_walk(const struct columns_info* p_info,
+                         int col,
+                         char* scratch,
+                         double* p_results,
+                         bool interrupt) {
+  const double* p_col = p_info->p_x + (R_xlen_t) col * p_info->x_size;
+
+  if (p_info->p_combiner == NULL) {
+    aggregate_native_walk(
+      p_info->p_aggregator,
+      p_col,
+      p_info->p_starts,
+      p_info->p_stops,
+      p_info->size,
+      scratch,
+      interrupt,
+      p_results
+    );
+  } else {
+    combine_native_walk(
+      p_info->p_combiner,
+      p_col,
+      p_info->width,
+      p_info->p_starts,
+      p_info->p_stops,
+      p_info->size,
+      scratch,
+      interrupt,
+      p_results
+    );
+  }
+
+  double* p_out = p_info->p_out + (R_xlen_t) col * p_info->x_size;
+
+  for (R_xlen_t i = 0; i < p_info->size; ++i) {
+    p_out[p_info->p_loc[i] - 1] = p_results[i];
+  }
+}
+
+// `x` is a double matrix. `loc`, `starts`, and `stops` are the 1-based
+// output locations and window boundaries shared by every column, and
+// `pointer` is a native aggregator, or a native combiner if `combiner` is
+// `TRUE`. With `parallel`, blocks of columns are walked on separate threads.
+// Returns a double matrix the same size as `x`, where locations that
+// aren't evaluated are `NA`.
+
+// [[ register() ]]
+SEXP slider_slide_columns(SEXP x,
+                          SEXP loc,
+                          SEXP starts,
+                          SEXP stops,
+                          SEXP pointer,
+                          SEXP combiner,
+                          SEXP parallel) {
+  const R_xlen_t x_size = Rf_nrows(x);
+  const int n_cols = Rf_ncols(x);
+  const R_xlen_t size = Rf_xlength(starts);
+
+  struct columns_info info = {
+    .p_x = REAL_RO(x),
+    .x_size = x_size,
+    .n_cols = n_cols,
+    .p_loc = INTEGER_RO(loc),
+    .p_starts = INTEGER_RO(starts),
+    .p_stops = INTEGER_RO(stops),
+    .size = size,
+    .p_aggregator = NULL,
+    .p_combiner = NULL,
+    .width = 0,
+    .scratch_size = 0,
+    .p_out = NULL
+  };
+
+  if (r_scalar_lgl_get(combiner)) {
+    info.p_combiner = slider_combiner_deref(pointer);
+    info.width = combine_max_width(info.p_starts, info.p_stops, size);
+    info.scratch_size = combine_native_buffer_size(info.p_combiner, info.width);
+  } else {
+    info.p_aggregator = slider_aggregator_deref(pointer);
+    info.scratch_size = info.p_aggregator->state_size;
+  }
+
+  SEXP out = PROTECT(Rf_allocMatrix(REALSXP, x_size, n_cols));
+  info.p_out = REAL(out);
+
+  const R_xlen_t out_size = x_size * n_cols;
+  for (R_xlen_t i = 0; i < out_size; ++i) {
+    info.p_out[i] = NA_REAL;
+  }
+
+  const int n_threads = compute_n_threads(r_scalar_lgl_get(parallel), n_cols);
+
+  char* p_scratch = R_alloc(n_threads, info.scratch_size);
+  double* p_results = (double*) R_alloc(n_threads * size, sizeof(double));
+
+  if (n_threads == 1) {
+    for (int col = 0; col < n_cols; ++col) {
+      R_CheckUserInterrupt();
+      columns_walk(&info, col, p_scratch, p_results, true);
+    }
+
+    UNPROTECT(1);
+    return out;
+  }
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(n_threads) schedule(static)
+  for (int col = 0; col < n_cols; ++col) {
+    const int thread = omp_get_thread_num();
+
+    columns_walk(
+      &info,
+      col,
+      p_scratch + thread * info.scratch_size,
+      p_results + thread * size,
+      false
+    );
+  }
+#endif
+
+  UNPROTECT(1);
+  return out;
+}
@@ -0,0 +1,505 @@
+#include "slider.h"
+#include "slider-vctrs.h"
+#include "utils.h"
+#include "aggregate.h"
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Two-stack sliding window aggregation
+//
+// Associative combine functions without an inverse can't evict elements by
+// subtracting them, so the window is split into two stacks instead:
+//
+// - The front stack, `[lo, m)`, holds suffix aggregates. `front[j]` is the
+//   combination of the elements `[j, m)`, so evicting `lo` is free.
+// - The back stack, `[m, hi)`, holds a single running aggregate of the
+//   elements pushed onto it, so pushing `hi` is one combine.
+//
+// The window is the combination of `front[lo]` and `back`. When an eviction
+// runs past `m`, the back stack is flipped onto the front stack by computing
+// the suffix aggregates of its elements. Every element is lifted once, and is
+// flipped at most once, so each step costs amortized O(1) combines.
+//
+// Like the incremental aggregation walk, windows that move backwards or don't
+// overlap the current window reset the stacks, and empty windows are marked
+// with `stop < start`.
+//
+// Both stacks only ever hold elements of the current window, and an element
+// is lifted only once every element at least a window width before it has
+// been evicted. The lifted values and suffix aggregates are therefore stored
+// in ring buffers the size of the widest window, with element `j` in slot
+// `j % width`, rather than in buffers the size of `x`.
+
+enum combine_slot_kind {
+  COMBINE_SLOT_LIFTED,
+  COMBINE_SLOT_FRONT,
+  COMBINE_SLOT_BACK,
+  COMBINE_SLOT_SCRATCH
+};
+
+struct combine_slot {
+  enum combine_slot_kind kind;
+  R_xlen_t j;
+};
+
+static inline struct combine_slot slot_lifted(R_xlen_t j) {
+  return (struct combine_slot) { .kind = COMBINE_SLOT_LIFTED, .j = j };
+}
+static inline struct combine_slot slot_front(R_xlen_t j) {
+  return (struct combine_slot) { .kind = COMBINE_SLOT_FRONT, .j = j };
+}
+static inline struct combine_slot slot_back(void) {
+  return (struct combine_slot) { .kind = COMBINE_SLOT_BACK, .j = 0 };
+}
+static inline struct combine_slot slot_scratch(void) {
+  return (struct combine_slot) { .kind = COMBINE_SLOT_SCRATCH, .j = 0 };
+}
+
+struct combine_ops {
+  void (*lift)(void* data, R_xlen_t j);
+  void (*copy)(void* data, struct combine_slot dst, struct combine_slot src);
+  void (*combine)(void* data, struct combine_slot dst, struct combine_slot a, struct combine_slot b);
+  void (*finalize)(void* data, struct combine_slot src, R_xlen_t i);
+  void (*empty)(void* data, R_xlen_t i);
+};
+
+// The widest of the `[starts, stops]` windows, which is the number of slots
+// needed by the ring buffers. Never less than 1, so it is safe to use as a
+// modulus.
+
+// [[ include("aggregate.h") ]]
+R_xlen_t combine_max_width(const int* p_starts, const int* p_stops, R_xlen_t size) {
+  R_xlen_t width = 1;
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    const R_xlen_t elt = (R_xlen_t) p_stops[i] - p_starts[i] + 1;
+
+    if (elt > width) {
+      width = elt;
+    }
+  }
+
+  return width;
+}
+
+static void combine_walk(const int* p_starts,
+                         const int* p_stops,
+                         R_xlen_t size,
+                         bool interrupt,
+                         const struct combine_ops* p_ops,
+                         void* data) {
+  R_xlen_t lo = 0;
+  R_xlen_t m = 0;
+  R_xlen_t hi = 0;
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    if (interrupt && i % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    const R_xlen_t start = (R_xlen_t) p_starts[i] - 1;
+    const R_xlen_t stop = (R_xlen_t) p_stops[i];
+
+    if (stop <= start) {
+      p_ops->empty(data, i);
+      continue;
+    }
+
+    if (start < lo || stop < hi || start >= hi) {
+      lo = start;
+      m = start;
+      hi = start;
+    }
+
+    // Push onto the back stack
+    for (; hi < stop; ++hi) {
+      p_ops->lift(data, hi);
+
+      if (hi == m) {
+        p_ops->copy(data, slot_back(), slot_lifted(hi));
+      } else {
+        p_ops->combine(data, slot_back(), slot_back(), slot_lifted(hi));
+      }
+    }
+
+    // Evicting past the front stack requires a flip. Suffix aggregates are
+    // only needed for the elements that remain in the window.
+    if (start > m) {
+      p_ops->copy(data, slot_front(hi - 1), slot_lifted(hi - 1));
+
+      for (R_xlen_t j = hi - 2; j >= start; --j) {
+        p_ops->combine(data, slot_front(j), slot_lifted(j), slot_front(j + 1));
+      }
+
+      m = hi;
+    }
+
+    lo = start;
+
+    const bool front_empty = lo == m;
+    const bool back_empty = hi == m;
+
+    if (front_empty) {
+      p_ops->finalize(data, slot_back(), i);
+    } else if (back_empty) {
+      p_ops->finalize(data, slot_front(lo), i);
+    } else {
+      p_ops->combine(data, slot_scratch(), slot_front(lo), slot_back());
+      p_ops->finalize(data, slot_scratch(), i);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+// R level combiners
+//
+// Values are arbitrary R objects. Lifted values and suffix aggregates are
+// stored in lists the size of the widest window, and the back aggregate and
+// scratch value live in `cell`, a list of size 2. Evicted values are
+// overwritten as the window moves on, so they can be garbage collected. Values are bound to `.x` and `.y` in
+// `env` before evaluating the `lift`, `combine`, and `finalize` calls.
+
+struct combine_r_data {
+  SEXP x;
+  SEXP window;
+  int* p_window;
+  SEXP env;
+  SEXP lift_call;
+  SEXP combine_call;
+  SEXP finalize_call;
+  SEXP empty;
+  R_xlen_t width;
+  SEXP lifted;
+  SEXP front;
+  SEXP cell;
+  SEXP out;
+};
+
+static SEXP combine_r_get(struct combine_r_data* p_data, struct combine_slot slot) {
+  switch (slot.kind) {
+  case COMBINE_SLOT_LIFTED: return VECTOR_ELT(p_data->lifted, slot.j % p_data->width);
+  case COMBINE_SLOT_FRONT: return VECTOR_ELT(p_data->front, slot.j % p_data->width);
+  case COMBINE_SLOT_BACK: return VECTOR_ELT(p_data->cell, 0);
+  case COMBINE_SLOT_SCRATCH: return VECTOR_ELT(p_data->cell, 1);
+  }
+  never_reached("combine_r_get");
+}
+
+static void combine_r_set(struct combine_r_data* p_data, struct combine_slot slot, SEXP value) {
+  switch (slot.kind) {
+  case COMBINE_SLOT_LIFTED: SET_VECTOR_ELT(p_data->lifted, slot.j % p_data->width, value); return;
+  case COMBINE_SLOT_FRONT: SET_VECTOR_ELT(p_data->front, slot.j % p_data->width, value); return;
+  case COMBINE_SLOT_BACK: SET_VECTOR_ELT(p_data->cell, 0, value); return;
+  case COMBINE_SLOT_SCRATCH: SET_VECTOR_ELT(p_data->cell, 1, value); return;
+  }
+  never_reached("combine_r_set");
+}
+
+static void combine_r_lift(void* data, R_xlen_t j) {
+  struct combine_r_data* p_data = (struct combine_r_data*) data;
+
+  init_compact_seq(p_data->p_window, j, 1, true);
+
+  SEXP slice = PROTECT(vec_slice_impl(p_data->x, p_data->window));
+  Rf_defineVar(syms_dot_x, slice, p_data->env);
+
+  SEXP value = r_force_eval(p_data->lift_call, p_data->env, 1);
+  combine_r_set(p_data, slot_lifted(j), value);
+
+  UNPROTECT(1);
+}
+
+static void combine_r_copy(void* data, struct combine_slot dst, struct combine_slot src) {
+  struct combine_r_data* p_data = (struct combine_r_data*) data;
+  combine_r_set(p_data, dst, combine_r_get(p_data, src));
+}
+
+static void combine_r_combine(void* data,
+                              struct combine_slot dst,
+                              struct combine_slot a,
+                              struct combine_slot b) {
+  struct combine_r_data* p_data = (struct combine_r_data*) data;
+
+  Rf_defineVar(syms_dot_x, combine_r_get(p_data, a), p_data->env);
+  Rf_defineVar(syms_dot_y, combine_r_get(p_data, b), p_data->env);
+
+  SEXP value = r_force_eval(p_data->combine_call, p_data->env, 2);
+  combine_r_set(p_data, dst, value);
+}
+
+static void combine_r_finalize(void* data, struct combine_slot src, R_xlen_t i) {
+  struct combine_r_data* p_data = (struct combine_r_data*) data;
+
+  Rf_defineVar(syms_dot_x, combine_r_get(p_data, src), p_data->env);
+
+  SEXP elt = r_force_eval(p_data->finalize_call, p_data->env, 1);
+  SET_VECTOR_ELT(p_data->out, i, elt);
+}
+
+static void combine_r_empty(void* data, R_xlen_t i) {
+  struct combine_r_data* p_data = (struct combine_r_data*) data;
+  SET_VECTOR_ELT(p_data->out, i, p_data->empty);
+}
+
+// `calls` is a list of the `lift`, `combine`, and `finalize` calls, which are
+// evaluated in `env`. `empty` is the result of empty windows. Returns a list
+// of the finalized result of each window.
+
+// [[ register() ]]
+SEXP slider_combine_r(SEXP x, SEXP starts, SEXP stops, SEXP calls, SEXP empty, SEXP env) {
+  const R_xlen_t size = Rf_xlength(starts);
+  const int* p_starts = INTEGER_RO(starts);
+  const int* p_stops = INTEGER_RO(stops);
+  const R_xlen_t width = combine_max_width(p_starts, p_stops, size);
+
+  SEXP window = PROTECT(compact_seq(0, 0, true));
+  SEXP lifted = PROTECT(Rf_allocVector(VECSXP, width));
+  SEXP front = PROTECT(Rf_allocVector(VECSXP, width));
+  SEXP cell = PROTECT(Rf_allocVector(VECSXP, 2));
+  SEXP out = PROTECT(Rf_allocVector(VECSXP, size));
+
+  struct combine_r_data data = {
+    .x = x,
+    .window = window,
+    .p_window = INTEGER(window),
+    .env = env,
+    .lift_call = VECTOR_ELT(calls, 0),
+    .combine_call = VECTOR_ELT(calls, 1),
+    .finalize_call = VECTOR_ELT(calls, 2),
+    .empty = empty,
+    .width = width,
+    .lifted = lifted,
+    .front = front,
+    .cell = cell,
+    .out = out
+  };
+
+  const struct combine_ops ops = {
+    .lift = combine_r_lift,
+    .copy = combine_r_copy,
+    .combine = combine_r_combine,
+    .finalize = combine_r_finalize,
+    .empty = combine_r_empty
+  };
+
+  combine_walk(p_starts, p_stops, size, true, &ops, &data);
+
+  UNPROTECT(5);
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+// Native combiners
+//
+// Values live in flat scratch buffers of `value_size` bytes per value, with
+// `width` slots each for the lifted values and the suffix aggregates.
+// `combine` always writes to a separate scratch value first, so it never sees
+// aliased arguments, even when the back aggregate is updated in place.
+
+struct combine_native_data {
+  const struct slider_combiner* p_combiner;
+  const double* p_x;
+  size_t value_size;
+  R_xlen_t width;
+  char* p_lifted;
+  char* p_front;
+  char* p_back;
+  char* p_scratch;
+  char* p_result;
+  double* p_out;
+};
+
+static void* combine_native_get(struct combine_native_data* p_data, struct combine_slot slot) {
+  switch (slot.kind) {
+  case COMBINE_SLOT_LIFTED: return p_data->p_lifted + (slot.j % p_data->width) * p_data->value_size;
+  case COMBINE_SLOT_FRONT: return p_data->p_front + (slot.j % p_data->width) * p_data->value_size;
+  case COMBINE_SLOT_BACK: return p_data->p_back;
+  case COMBINE_SLOT_SCRATCH: return p_data->p_scratch;
+  }
+  never_reached("combine_native_get");
+}
+
+static void combine_native_lift(void* data, R_xlen_t j) {
+  struct combine_native_data* p_data = (struct combine_native_data*) data;
+  p_data->p_combiner->lift(combine_native_get(p_data, slot_lifted(j)), p_data->p_x[j]);
+}
+
+static void combine_native_copy(void* data, struct combine_slot dst, struct combine_slot src) {
+  struct combine_native_data* p_data = (struct combine_native_data*) data;
+
+  memcpy(
+    combine_native_get(p_data, dst),
+    combine_native_get(p_data, src),
+    p_data->value_size
+  );
+}
+
+static void combine_native_combine(void* data,
+                                   struct combine_slot dst,
+                                   struct combine_slot a,
+                                   struct combine_slot b) {
+  struct combine_native_data* p_data = (struct combine_native_data*) data;
+
+  p_data->p_combiner->combine(
+    p_data->p_result,
+    combine_native_get(p_data, a),
+    combine_native_get(p_data, b)
+  );
+
+  memcpy(combine_native_get(p_data, dst), p_data->p_result, p_data->value_size);
+}
+
+static void combine_native_finalize(void* data, struct combine_slot src, R_xlen_t i) {
+  struct combine_native_data* p_data = (struct combine_native_data*) data;
+  p_data->p_out[i] = p_data->p_combiner->finalize(combine_native_get(p_data, src));
+}
+
+static void combine_native_empty(void* data, R_xlen_t i) {
+  struct combine_native_data* p_data = (struct combine_native_data*) data;
+  p_data->p_out[i] = NA_REAL;
+}
+
+// The number of bytes of scratch memory needed to walk windows that are at
+// most `width` elements wide, as computed by `combine_max_width()`. That is
+// the lifted values and the front stack, plus the back aggregate, the
+// scratch value, and the result of `combine`.
+size_t combine_native_buffer_size(const struct slider_combiner* p_combiner, R_xlen_t width) {
+  return (2 * (size_t) width + 3) * p_combiner->value_size;
+}
+
+// `buffer` is `combine_native_buffer_size()` bytes of scratch memory owned by
+// the caller, for windows that are at most `width` elements wide. With
+// `interrupt = false` this never touches the R API, so independent walks can
+// run concurrently, each with its own `buffer`.
+void combine_native_walk(const struct slider_combiner* p_combiner,
+                         const double* p_x,
+                         R_xlen_t width,
+                         const int* p_starts,
+                         const int* p_stops,
+                         R_xlen_t size,
+                         void* buffer,
+                         bool interrupt,
+                         double* p_out) {
+  const size_t value_size = p_combiner->value_size;
+  char* p_buffer = (char*) buffer;
+
+  struct combine_native_data data = {
+    .p_combiner = p_combiner,
+    .p_x = p_x,
+    .value_size = value_size,
+    .width = width,
+    .p_lifted = p_buffer,
+    .p_front = p_buffer + width * value_size,
+    .p_back = p_buffer + 2 * width * value_size,
+    .p_scratch = p_buffer + (2 * width + 1) * value_size,
+    .p_result = p_buffer + (2 * width + 2) * value_size,
+    .p_out = p_out
+  };
+
+  const struct combine_ops ops = {
+    .lift = combine_native_lift,
+    .copy = combine_native_copy,
+    .combine = combine_native_combine,
+    .finalize = combine_native_finalize,
+    .empty = combine_native_empty
+  };
+
+  combine_walk(p_starts, p_stops, size, interrupt, &ops, &data);
+}
+
+void combine_native(const struct slider_combiner* p_combiner,
+                    const double* p_x,
+                    const int* p_starts,
+                    const int* p_stops,
+                    R_xlen_t size,
+                    double* p_out) {
+  const R_xlen_t width = combine_max_width(p_starts, p_stops, size);
+
+  combine_native_walk(
+    p_combiner,
+    p_x,
+    width,
+    p_starts,
+    p_stops,
+    size,
+    R_alloc(combine_native_buffer_size(p_combiner, width), 1),
+    true,
+    p_out
+  );
+}
+
+// [[ register() ]]
+SEXP slider_combine_native(SEXP x, SEXP starts, SEXP stops, SEXP pointer) {
+  const R_xlen_t size = Rf_xlength(starts);
+  const struct slider_combiner* p_combiner = slider_combiner_deref(pointer);
+
+  SEXP out = PROTECT(Rf_allocVector(REALSXP, size));
+
+  combine_native(
+    p_combiner,
+    REAL_RO(x),
+    INTEGER_RO(starts),
+    INTEGER_RO(stops),
+    size,
+    REAL(out)
+  );
+
+  UNPROTECT(1);
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
+static void combiner_finalizer(SEXP pointer) {
+  struct slider_combiner* p_combiner = R_ExternalPtrAddr(pointer);
+
+  if (p_combiner == NULL) {
+    return;
+  }
+
+  R_Free(p_combiner);
+  R_ClearExternalPtr(pointer);
+}
+
+// Look up the callbacks of a native combiner registered by `package` with
+// `R_RegisterCCallable()`. `names` holds the names of the `lift`, `combine`,
+// and `finalize` callables.
+
+// [[ register() ]]
+SEXP slider_new_combiner_native(SEXP package, SEXP names, SEXP value_size) {
+  const char* c_package = r_scalar_chr_get(package);
+
+  slider_combiner_lift_fn lift =
+    (slider_combiner_lift_fn) R_GetCCallable(c_package, CHAR(STRING_ELT(names, 0)));
+  slider_combiner_combine_fn combine =
+    (slider_combiner_combine_fn) R_GetCCallable(c_package, CHAR(STRING_ELT(names, 1)));
+  slider_combiner_finalize_fn finalize =
+    (slider_combiner_finalize_fn) R_GetCCallable(c_package, CHAR(STRING_ELT(names, 2)));
+
+  struct slider_combiner* p_combiner = R_Calloc(1, struct slider_combiner);
+
+  p_combiner->value_size = (size_t) r_scalar_int_get(value_size);
+  p_combiner->lift = lift;
+  p_combiner->combine = combine;
+  p_combiner->finalize = finalize;
+
+  SEXP out = PROTECT(R_MakeExternalPtr(p_combiner, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(out, combiner_finalizer, TRUE);
+
+  UNPROTECT(1);
+  return out;
+}
+
+struct slider_combiner* slider_combiner_deref(SEXP pointer) {
+  struct slider_combiner* p_combiner = R_ExternalPtrAddr(pointer);
+
+  if (p_combiner == NULL) {
+    Rf_errorcall(
+      R_NilValue,
+      "This native combiner is no longer valid. "
+      "Native combiners can't be saved and reloaded, recreate it instead."
+    );
+  }
+
+  return p_combiner;
+}
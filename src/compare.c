@@ -120,146 +120,62 @@ static int compare_scalar(SEXP x, R_len_t i, SEXP y, R_len_t j) {
 
 // -----------------------------------------------------------------------------
 
-#define SCALAR_COMPARE_DIRECTION(CONST_DEREF, SCALAR_COMPARE, RELATION, TO)  \
-do {                                                                         \
-  return SCALAR_COMPARE(CONST_DEREF(x) + i, CONST_DEREF(y) + j) RELATION TO; \
-}                                                                            \
-while (0)
-
-static bool lgl_compare_lt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(LOGICAL_RO, lgl_compare_scalar, ==, -1);
-}
-static bool int_compare_lt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(INTEGER_RO, int_compare_scalar, ==, -1);
-}
-static bool dbl_compare_lt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(REAL_RO, dbl_compare_scalar, ==, -1);
-}
-static bool chr_compare_lt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(STRING_PTR_RO, chr_compare_scalar, ==, -1);
-}
-static bool df_compare_lt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  int n_col = Rf_length(x);
-
-  if (n_col != Rf_length(y)) {
-    stop_not_comparable(x, y, "must have the same number of columns");
-  }
-
-  if (n_col == 0) {
-    stop_not_comparable(x, y, "data frame with zero columns");
-  }
-
-  return df_compare_scalar(x, i, y, j, n_col) == -1;
-}
+// Comparators for the window engine. Atomic vectors are handed to the engine
+// as pointers to their data, and are compared with the typed comparators of
+// `window.c`. Character vectors and data frames need the R API to be
+// compared, so they are handed over as the `SEXP` itself.
 
-static bool lgl_compare_gt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(LOGICAL_RO, lgl_compare_scalar, ==, 1);
-}
-static bool int_compare_gt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(INTEGER_RO, int_compare_scalar, ==, 1);
+static int chr_window_compare(const void* x, int i, const void* y, int j) {
+  return chr_compare_scalar(STRING_PTR_RO((SEXP) x) + i, STRING_PTR_RO((SEXP) y) + j);
 }
-static bool dbl_compare_gt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(REAL_RO, dbl_compare_scalar, ==, 1);
-}
-static bool chr_compare_gt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(STRING_PTR_RO, chr_compare_scalar, ==, 1);
-}
-static bool df_compare_gt(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  int n_col = Rf_length(x);
-
-  if (n_col != Rf_length(y)) {
-    stop_not_comparable(x, y, "must have the same number of columns");
-  }
-
-  if (n_col == 0) {
-    stop_not_comparable(x, y, "data frame with zero columns");
-  }
 
-  return df_compare_scalar(x, i, y, j, n_col) == 1;
-}
+static int df_window_compare(const void* x, int i, const void* y, int j) {
+  SEXP x_ = (SEXP) x;
+  SEXP y_ = (SEXP) y;
 
-static bool lgl_compare_lte(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(LOGICAL_RO, lgl_compare_scalar, <=, 0);
-}
-static bool int_compare_lte(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(INTEGER_RO, int_compare_scalar, <=, 0);
-}
-static bool dbl_compare_lte(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(REAL_RO, dbl_compare_scalar, <=, 0);
-}
-static bool chr_compare_lte(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  SCALAR_COMPARE_DIRECTION(STRING_PTR_RO, chr_compare_scalar, <=, 0);
-}
-static bool df_compare_lte(SEXP x, R_len_t i, SEXP y, R_len_t j) {
-  int n_col = Rf_length(x);
+  int n_col = Rf_length(x_);
 
-  if (n_col != Rf_length(y)) {
-    stop_not_comparable(x, y, "must have the same number of columns");
+  if (n_col != Rf_length(y_)) {
+    stop_not_comparable(x_, y_, "must have the same number of columns");
   }
 
   if (n_col == 0) {
-    stop_not_comparable(x, y, "data frame with zero columns");
+    stop_not_comparable(x_, y_, "data frame with zero columns");
   }
 
-  return df_compare_scalar(x, i, y, j, n_col) <= 0;
+  return df_compare_scalar(x_, i, y_, j, n_col);
 }
 
 // [[ include("compare.h") ]]
-slider_compare_fn_t get_compare_fn_lt(SEXP x) {
+window_compare_fn get_window_compare_fn(SEXP x) {
   switch (TYPEOF(x)) {
-  case LGLSXP: return lgl_compare_lt;
-  case INTSXP: return int_compare_lt;
-  case REALSXP: return dbl_compare_lt;
-  case STRSXP: return chr_compare_lt;
+  case LGLSXP: return window_compare_int;
+  case INTSXP: return window_compare_int;
+  case REALSXP: return window_compare_dbl;
+  case STRSXP: return chr_window_compare;
   case VECSXP: {
     if (!is_data_frame(x)) {
       Rf_errorcall(R_NilValue, "`x` and `y` are not comparable, lists are not comparable.");
     }
-    return df_compare_lt;
-  }
-  default:
-    Rf_errorcall(R_NilValue, "Unsupported type %s", Rf_type2char(TYPEOF(x)));
-  }
-}
-
-// [[ include("compare.h") ]]
-slider_compare_fn_t get_compare_fn_gt(SEXP x) {
-  switch (TYPEOF(x)) {
-  case LGLSXP: return lgl_compare_gt;
-  case INTSXP: return int_compare_gt;
-  case REALSXP: return dbl_compare_gt;
-  case STRSXP: return chr_compare_gt;
-  case VECSXP: {
-    if (!is_data_frame(x)) {
-    Rf_errorcall(R_NilValue, "`x` and `y` are not comparable, lists are not comparable.");
-  }
-    return df_compare_gt;
+    return df_window_compare;
   }
   default:
     Rf_errorcall(R_NilValue, "Unsupported type %s", Rf_type2char(TYPEOF(x)));
   }
 }
 
+// `NULL` is passed through as `NULL`, which marks unbounded ranges
 // [[ include("compare.h") ]]
-slider_compare_fn_t get_compare_fn_lte(SEXP x) {
+const void* get_window_compare_data(SEXP x) {
   switch (TYPEOF(x)) {
-  case LGLSXP: return lgl_compare_lte;
-  case INTSXP: return int_compare_lte;
-  case REALSXP: return dbl_compare_lte;
-  case STRSXP: return chr_compare_lte;
-  case VECSXP: {
-    if (!is_data_frame(x)) {
-    Rf_errorcall(R_NilValue, "`x` and `y` are not comparable, lists are not comparable.");
-  }
-    return df_compare_lte;
-  }
-  default:
-    Rf_errorcall(R_NilValue, "Unsupported type %s", Rf_type2char(TYPEOF(x)));
+  case NILSXP: return NULL;
+  case LGLSXP: return LOGICAL_RO(x);
+  case INTSXP: return INTEGER_RO(x);
+  case REALSXP: return REAL_RO(x);
+  default: return x;
   }
 }
 
-#undef SCALAR_COMPARE_DIRECTION
-
 // -----------------------------------------------------------------------------
 
 static bool df_any_gt(SEXP x, SEXP y, R_len_t n_row);
@@ -2,12 +2,10 @@
 #define SLIDER_COMPARE_H
 
 #include "slider.h"
+#include "window.h"
 
-typedef bool (*slider_compare_fn_t)(SEXP, R_len_t, SEXP, R_len_t);
-
-slider_compare_fn_t get_compare_fn_lt(SEXP x);
-slider_compare_fn_t get_compare_fn_gt(SEXP x);
-slider_compare_fn_t get_compare_fn_lte(SEXP x);
+window_compare_fn get_window_compare_fn(SEXP x);
+const void* get_window_compare_data(SEXP x);
 
 bool vec_any_gt(SEXP x, SEXP y);
 
@@ -0,0 +1,88 @@
+#ifndef SLIDER_FENWICK_H
+#define SLIDER_FENWICK_H
+
+#include "slider.h"
+
+// -----------------------------------------------------------------------------
+// Fenwick trees
+//
+// A Fenwick tree counts elements by an integer code in `1, ..., size`, and
+// answers how many elements have a code of at most some value, or which code
+// the `k`-th smallest element has, each in O(log(size)). Rolling kernels use
+// them to keep the elements of a window ordered while they are added and
+// evicted, without ever sorting the window.
+
+struct fenwick {
+  int size;
+  int* p_counts;
+};
+
+static inline struct fenwick new_fenwick(int size) {
+  struct fenwick tree;
+  tree.size = size;
+  tree.p_counts = (int*) R_alloc(size, sizeof(int));
+  memset(tree.p_counts, 0, size * sizeof(int));
+  return tree;
+}
+
+static inline void fenwick_update(struct fenwick* p_tree, int code, int delta) {
+  for (; code <= p_tree->size; code += code & -code) {
+    p_tree->p_counts[code - 1] += delta;
+  }
+}
+
+// Add (`delta = 1`) or remove (`delta = -1`) the elements at the 0-based
+// locations `[from, to)`, by their code in `p_codes`, skipping missing codes.
+// `*p_n` is kept as the number of elements in the tree.
+static inline void fenwick_update_range(struct fenwick* p_tree,
+                                        const int* p_codes,
+                                        R_xlen_t from,
+                                        R_xlen_t to,
+                                        int delta,
+                                        int* p_n) {
+  for (R_xlen_t loc = from; loc < to; ++loc) {
+    const int code = p_codes[loc];
+
+    if (code == NA_INTEGER) {
+      continue;
+    }
+
+    fenwick_update(p_tree, code, delta);
+    *p_n += delta;
+  }
+}
+
+// The number of elements with a code of at most `code`
+static inline int fenwick_prefix(const struct fenwick* p_tree, int code) {
+  int out = 0;
+
+  for (; code > 0; code -= code & -code) {
+    out += p_tree->p_counts[code - 1];
+  }
+
+  return out;
+}
+
+// The code of the `k`-th smallest element, for a 1-based `k` of at most the
+// number of elements in the tree
+static inline int fenwick_find(const struct fenwick* p_tree, int k) {
+  int step = 1;
+  while (step * 2 <= p_tree->size) {
+    step *= 2;
+  }
+
+  int code = 0;
+
+  for (; step > 0; step /= 2) {
+    const int next = code + step;
+
+    if (next <= p_tree->size && p_tree->p_counts[next - 1] < k) {
+      code = next;
+      k -= p_tree->p_counts[next - 1];
+    }
+  }
+
+  return code + 1;
+}
+
+#endif
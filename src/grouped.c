@@ -0,0 +1,126 @@
+#include "slider.h"
+#include "utils.h"
+#include "aggregate.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Grouped kernels
+//
+// The windows of a grouped slide are stored back to back, with the windows
+// of group `g` running from `breaks[g]` to `breaks[g + 1]`. A single walk
+// over all of them already resets its state at every group boundary, as the
+// windows of the next group never overlap the current one. Walking each
+// group on its own instead lets the groups run on separate threads, each
+// with its own scratch memory.
+
+struct groups_info {
+  const double* p_x;
+  R_xlen_t width;
+  const int* p_starts;
+  const int* p_stops;
+  const int* p_breaks;
+  const struct slider_aggregator* p_aggregator;
+  const struct slider_combiner* p_combiner;
+  double* p_out;
+};
+
+static void groups_walk(const struct groups_info* p_info, int g, void* scratch) {
+  const int from = p_info->p_breaks[g];
+  const int size = p_info->p_breaks[g + 1] - from;
+
+  if (p_info->p_combiner == NULL) {
+    aggregate_native_walk(
+      p_info->p_aggregator,
+      p_info->p_x,
+      p_info->p_starts + from,
+      p_info->p_stops + from,
+      size,
+      scratch,
+      false,
+      p_info->p_out + from
+    );
+  } else {
+    combine_native_walk(
+      p_info->p_combiner,
+      p_info->p_x,
+      p_info->width,
+      p_info->p_starts + from,
+      p_info->p_stops + from,
+      size,
+      scratch,
+      false,
+      p_info->p_out + from
+    );
+  }
+}
+
+// `starts` and `stops` are the 1-based windows of every group, and `breaks`
+// are the 0-based offsets of the windows of each group, with one extra
+// element holding the total number of windows. `pointer` is a native
+// aggregator, or a native combiner if `combiner` is `TRUE`. With `parallel`,
+// groups are walked on separate threads. Returns the result of each window.
+
+// [[ register() ]]
+SEXP slider_aggregate_groups(SEXP x,
+                             SEXP starts,
+                             SEXP stops,
+                             SEXP breaks,
+                             SEXP pointer,
+                             SEXP combiner,
+                             SEXP parallel) {
+  const R_xlen_t size = Rf_xlength(starts);
+  const int n_groups = Rf_length(breaks) - 1;
+
+  SEXP out = PROTECT(Rf_allocVector(REALSXP, size));
+
+  struct groups_info info = {
+    .p_x = REAL_RO(x),
+    .width = 0,
+    .p_starts = INTEGER_RO(starts),
+    .p_stops = INTEGER_RO(stops),
+    .p_breaks = INTEGER_RO(breaks),
+    .p_aggregator = NULL,
+    .p_combiner = NULL,
+    .p_out = REAL(out)
+  };
+
+  size_t scratch_size;
+
+  if (r_scalar_lgl_get(combiner)) {
+    info.p_combiner = slider_combiner_deref(pointer);
+    info.width = combine_max_width(info.p_starts, info.p_stops, size);
+    scratch_size = combine_native_buffer_size(info.p_combiner, info.width);
+  } else {
+    info.p_aggregator = slider_aggregator_deref(pointer);
+    scratch_size = info.p_aggregator->state_size;
+  }
+
+  const int n_threads = compute_n_threads(r_scalar_lgl_get(parallel), n_groups);
+
+  if (n_threads == 1) {
+    // A single walk over every window, which checks for interrupts
+    if (info.p_combiner == NULL) {
+      aggregate_native(info.p_aggregator, info.p_x, info.p_starts, info.p_stops, size, info.p_out);
+    } else {
+      combine_native(info.p_combiner, info.p_x, info.p_starts, info.p_stops, size, info.p_out);
+    }
+
+    UNPROTECT(1);
+    return out;
+  }
+
+  char* p_scratch = R_alloc(n_threads, scratch_size);
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(n_threads) schedule(dynamic, 64)
+  for (int g = 0; g < n_groups; ++g) {
+    groups_walk(&info, g, p_scratch + omp_get_thread_num() * scratch_size);
+  }
+#endif
+
+  UNPROTECT(1);
+  return out;
+}
@@ -0,0 +1,162 @@
+#include "slider.h"
+#include "utils.h"
+#include "aggregate.h"
+
+// -----------------------------------------------------------------------------
+// Rolling histograms
+//
+// The window is summarised by its counts per bin. Every element of `x` is
+// placed in its bin once, with a binary search over the bin edges, and the
+// counts are then updated as elements enter and leave the window. The counts
+// of every window are copied to one row of an integer matrix.
+
+// The 0-based bin of `x` for the ascending `p_breaks`, or `-1` if `x` is
+// missing or outside of all of the bins. With `right = true`, bins are
+// `(lower, upper]`, otherwise `[lower, upper)`, and the outermost edges
+// are always included, like `hist()`.
+static inline int histogram_bin(double x, const double* p_breaks, int n_breaks, bool right) {
+  if (isnan(x) || x < p_breaks[0] || x > p_breaks[n_breaks - 1]) {
+    return -1;
+  }
+
+  // Find the first edge that is `>= x` (`right`) or `> x` (`!right`)
+  int lo = 0;
+  int hi = n_breaks - 1;
+
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    const bool after = right ? p_breaks[mid] >= x : p_breaks[mid] > x;
+
+    if (after) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  // `lo` is the upper edge of the bin, except for values on the outermost
+  // edges, which belong to the first or last bin
+  const int n_bins = n_breaks - 1;
+
+  if (right) {
+    return lo == 0 ? 0 : lo - 1;
+  } else {
+    return (x == p_breaks[n_breaks - 1]) ? n_bins - 1 : lo - 1;
+  }
+}
+
+static inline void histogram_row_assign(const int* p_counts,
+                                        int n_bins,
+                                        R_xlen_t row,
+                                        R_xlen_t n_rows,
+                                        int* p_out) {
+  for (int j = 0; j < n_bins; ++j) {
+    p_out[j * n_rows + row] = p_counts[j];
+  }
+}
+
+// The window walk of `aggregate_walk()`, which holds the counts of the
+// window per bin in `p_counts`
+struct histogram_data {
+  int* p_counts;
+  int n_bins;
+  const int* p_bins;
+  R_xlen_t x_size;
+  SEXP loc;
+  int* p_out;
+};
+
+static void histogram_reset(void* data) {
+  struct histogram_data* p_data = (struct histogram_data*) data;
+  memset(p_data->p_counts, 0, p_data->n_bins * sizeof(int));
+}
+
+static void histogram_add(void* data, R_xlen_t from, R_xlen_t to) {
+  struct histogram_data* p_data = (struct histogram_data*) data;
+
+  for (R_xlen_t i = from; i < to; ++i) {
+    const int bin = p_data->p_bins[i];
+
+    if (bin >= 0) {
+      ++p_data->p_counts[bin];
+    }
+  }
+}
+
+static void histogram_remove(void* data, R_xlen_t from, R_xlen_t to) {
+  struct histogram_data* p_data = (struct histogram_data*) data;
+
+  for (R_xlen_t i = from; i < to; ++i) {
+    const int bin = p_data->p_bins[i];
+
+    if (bin >= 0) {
+      --p_data->p_counts[bin];
+    }
+  }
+}
+
+static void histogram_finalize(void* data, R_xlen_t i, R_xlen_t lo, R_xlen_t hi) {
+  struct histogram_data* p_data = (struct histogram_data*) data;
+
+  R_xlen_t n_locs;
+  const int* p_locs = aggregate_loc(p_data->loc, i, &n_locs);
+
+  for (R_xlen_t j = 0; j < n_locs; ++j) {
+    histogram_row_assign(p_data->p_counts, p_data->n_bins, p_locs[j] - 1, p_data->x_size, p_data->p_out);
+  }
+}
+
+// `breaks` are the ascending bin edges. `starts`, `stops`, and `loc` are as
+// for `slider_slide_summarise()`. Returns an integer matrix with one row per
+// element of `x` and one column per bin, where rows without a window are
+// `NA`.
+
+// [[ register() ]]
+SEXP slider_slide_histogram(SEXP x,
+                            SEXP breaks,
+                            SEXP right,
+                            SEXP starts,
+                            SEXP stops,
+                            SEXP loc) {
+  const int x_size = Rf_length(x);
+  const int n_breaks = Rf_length(breaks);
+  const int n_bins = n_breaks - 1;
+
+  const double* p_x = REAL_RO(x);
+  const double* p_breaks = REAL_RO(breaks);
+  const bool right_ = r_scalar_lgl_get(right);
+
+  SEXP out = PROTECT(Rf_allocMatrix(INTSXP, x_size, n_bins));
+  int* p_out = INTEGER(out);
+
+  const R_xlen_t out_size = (R_xlen_t) x_size * n_bins;
+  for (R_xlen_t i = 0; i < out_size; ++i) {
+    p_out[i] = NA_INTEGER;
+  }
+
+  int* p_bins = (int*) R_alloc(x_size, sizeof(int));
+  for (int i = 0; i < x_size; ++i) {
+    p_bins[i] = histogram_bin(p_x[i], p_breaks, n_breaks, right_);
+  }
+
+  struct histogram_data data = {
+    .p_counts = (int*) R_alloc(n_bins, sizeof(int)),
+    .n_bins = n_bins,
+    .p_bins = p_bins,
+    .x_size = x_size,
+    .loc = loc,
+    .p_out = p_out
+  };
+
+  const struct aggregate_ops ops = {
+    .reset = histogram_reset,
+    .add = histogram_add,
+    .remove = histogram_remove,
+    .finalize = histogram_finalize
+  };
+
+  aggregate_walk(INTEGER_RO(starts), INTEGER_RO(stops), Rf_xlength(starts), true, &ops, &data);
+
+  UNPROTECT(1);
+  return out;
+}
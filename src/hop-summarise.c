@@ -0,0 +1,62 @@
+#include "slider.h"
+#include "slider-vctrs.h"
+#include "utils.h"
+#include "summary.h"
+
+// -----------------------------------------------------------------------------
+
+// Summarise arbitrary `[starts, stops]` windows of `x`. Rather than slicing
+// every window, which repeats a lot of work when the windows overlap heavily,
+// a `summary_cache` is built once per call, and each window is then answered
+// in O(1) from the cache.
+
+// [[ export() ]]
+SEXP slider_hop_summarise(SEXP x, SEXP starts, SEXP stops, SEXP stats, SEXP na_rm) {
+  int n_prot = 0;
+
+  check_hop_starts_not_past_stops(starts, stops);
+
+  const bool na_rm_ = r_scalar_lgl_get(na_rm);
+
+  const int x_size = vec_size(x);
+  const R_len_t size = vec_size(starts);
+
+  const double* p_x = REAL_RO(x);
+  const int* p_starts = INTEGER_RO(starts);
+  const int* p_stops = INTEGER_RO(stops);
+
+  // Convert to 0-based locations, restricted to the range of `x`,
+  // exactly like `hop()` does
+  int* p_window_starts = (int*) R_alloc(size, sizeof(int));
+  int* p_window_stops = (int*) R_alloc(size, sizeof(int));
+
+  int max_width = 0;
+
+  for (R_len_t i = 0; i < size; ++i) {
+    const int window_start = max(p_starts[i] - 1, 0);
+    const int window_stop = min(p_stops[i] - 1, x_size - 1);
+
+    p_window_starts[i] = window_start;
+    p_window_stops[i] = window_stop;
+
+    max_width = max(max_width, window_stop - window_start + 1);
+  }
+
+  struct summary_cache cache = new_summary_cache(p_x, x_size, stats, na_rm_, max_width);
+
+  struct summary_cols cols = new_summary_cols(stats, size);
+  PROTECT_SUMMARY_COLS(&cols, &n_prot);
+
+  for (R_len_t i = 0; i < size; ++i) {
+    if (i % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    struct summary summary;
+    summary_cache_query(&cache, p_window_starts[i], p_window_stops[i], &summary);
+    summary_cols_assign(cols, i, &summary);
+  }
+
+  UNPROTECT(n_prot);
+  return cols.data;
+}
@@ -15,16 +15,40 @@ static void fill_window_info(int* window_sizes,
                              int size);
 
 static struct window_info new_window_info(int*, int*, int);
-static struct index_info new_index_info(SEXP);
-static struct range_info new_range_info(SEXP, SEXP, int);
-
-static int compute_min_iteration(struct index_info index, struct range_info range, bool complete);
-static int compute_max_iteration(struct index_info index, struct range_info range, bool complete);
-
-static void increment_window(struct window_info window,
-                             struct index_info* index,
-                             struct range_info range,
-                             int pos);
+static struct window_index new_index_info(SEXP);
+static struct window_range new_range_info(SEXP, SEXP, int);
+
+static void locate_window(struct window_info window,
+                          struct window_index* index,
+                          struct window_range range,
+                          int pos,
+                          int* p_start,
+                          int* p_stop);
+
+// The result of the last window, and of the empty window, so they can be
+// reused when the next window covers the exact same range of `x`
+struct window_cache {
+  bool enabled;
+  int start;
+  int stop;
+  bool has_last;
+  bool has_empty;
+  SEXP results;
+};
+
+static struct window_cache new_window_cache(bool enabled, SEXP results);
+
+static SEXP eval_window(struct window_cache* p_cache,
+                        struct window_info window,
+                        struct window_index* index,
+                        struct window_range range,
+                        int pos,
+                        SEXP x,
+                        SEXP f_call,
+                        SEXP env,
+                        int type,
+                        int force,
+                        SEXP container);
 
 // -----------------------------------------------------------------------------
 
@@ -34,17 +58,26 @@ static void increment_window(struct window_info window,
       R_CheckUserInterrupt();                                  \
     }                                                          \
                                                                \
-    increment_window(window, &index, range, i);                \
-    slice_and_update_env(x, window.seq, env, type, container); \
+    SEXP locations = VECTOR_ELT(indices, i);                   \
+                                                               \
+    /* Skipped locations keep their initialised value */       \
+    if (where != R_NilValue) {                                 \
+      locations = VECTOR_ELT(where, i);                        \
+                                                               \
+      if (Rf_length(locations) == 0) {                         \
+        continue;                                              \
+      }                                                        \
+    }                                                          \
                                                                \
-    SEXP elt = PROTECT(r_force_eval(f_call, env, force));      \
+    SEXP elt = PROTECT(eval_window(                            \
+      &cache, window, &index, range, i,                        \
+      x, f_call, env, type, force, container                   \
+    ));                                                        \
                                                                \
     if (atomic && vec_size(elt) != 1) {                        \
       stop_not_all_size_one(i + 1, vec_size(elt));             \
     }                                                          \
                                                                \
-    SEXP locations = VECTOR_ELT(indices, i);                   \
-                                                               \
     ASSIGN_LOCS(p_out, locations, elt, ptype);                 \
     UNPROTECT(1);                                              \
   }                                                            \
@@ -84,7 +117,9 @@ SEXP slide_index_common_impl(SEXP x,
                              SEXP constrain_,
                              SEXP atomic_,
                              SEXP size_,
-                             SEXP complete_) {
+                             SEXP complete_,
+                             SEXP reuse_,
+                             SEXP where) {
   int n_prot = 0;
 
   const int type = r_scalar_int_get(type_);
@@ -93,9 +128,12 @@ SEXP slide_index_common_impl(SEXP x,
   const bool atomic = r_scalar_lgl_get(atomic_);
   const int size = r_scalar_int_get(size_);
   const bool complete = r_scalar_lgl_get(complete_);
+  const bool reuse = r_scalar_lgl_get(reuse_);
 
-  struct index_info index = new_index_info(i);
-  PROTECT_INDEX_INFO(&index, &n_prot);
+  // `where` is either `NULL`, or a list holding the locations to assign to
+  // for each unique value of `i`. Values without any locations are skipped.
+
+  struct window_index index = new_index_info(i);
 
   int* window_sizes = (int*) R_alloc(index.size, sizeof(int));
   int* window_starts = (int*) R_alloc(index.size, sizeof(int));
@@ -106,14 +144,16 @@ SEXP slide_index_common_impl(SEXP x,
   struct window_info window = new_window_info(window_starts, window_stops, index.size);
   PROTECT_WINDOW_INFO(&window, &n_prot);
 
-  struct range_info range = new_range_info(starts, stops, index.size);
-  PROTECT_RANGE_INFO(&range, &n_prot);
+  struct window_range range = new_range_info(starts, stops, index.size);
 
-  const int min_iteration = compute_min_iteration(index, range, complete);
-  const int max_iteration = compute_max_iteration(index, range, complete);
+  const int min_iteration = window_min_iteration(index, range, complete);
+  const int max_iteration = window_max_iteration(index, range, complete);
 
   SEXP container = PROTECT_N(make_slice_container(type), &n_prot);
 
+  SEXP cache_results = PROTECT_N(Rf_allocVector(VECSXP, 2), &n_prot);
+  struct window_cache cache = new_window_cache(reuse, cache_results);
+
   SEXPTYPE out_type = TYPEOF(ptype);
   SEXP out = PROTECT_N(slider_init(out_type, size), &n_prot);
 
@@ -139,16 +179,193 @@ SEXP slide_index_common_impl(SEXP x,
 
 // -----------------------------------------------------------------------------
 
+// Compute the windows that `slide_index_common_impl()` would evaluate,
+// without evaluating anything. There is one window per unique value of `i`.
+// Returns a list of:
+// - `group`: The 1-based locations of the unique values of `i` that would be
+//   evaluated. `indices[group]` maps them back to locations in `x`.
+// - `start` / `stop`: The 1-based window boundaries in `x` for each of
+//   those groups. Empty windows have `start = 1` and `stop = 0`.
+
+// [[ register() ]]
+SEXP slide_index_windows_impl(SEXP i,
+                              SEXP starts,
+                              SEXP stops,
+                              SEXP indices,
+                              SEXP complete_) {
+  int n_prot = 0;
+
+  const bool complete = r_scalar_lgl_get(complete_);
+
+  struct window_index index = new_index_info(i);
+
+  int* window_sizes = (int*) R_alloc(index.size, sizeof(int));
+  int* window_starts = (int*) R_alloc(index.size, sizeof(int));
+  int* window_stops = (int*) R_alloc(index.size, sizeof(int));
+
+  fill_window_info(window_sizes, window_starts, window_stops, indices, index.size);
+
+  struct window_info window = new_window_info(window_starts, window_stops, index.size);
+  PROTECT_WINDOW_INFO(&window, &n_prot);
+
+  struct window_range range = new_range_info(starts, stops, index.size);
+
+  const int min_iteration = window_min_iteration(index, range, complete);
+  const int max_iteration = window_max_iteration(index, range, complete);
+
+  const int n = max(max_iteration - min_iteration, 0);
+
+  SEXP group = PROTECT_N(Rf_allocVector(INTSXP, n), &n_prot);
+  SEXP out_starts = PROTECT_N(Rf_allocVector(INTSXP, n), &n_prot);
+  SEXP out_stops = PROTECT_N(Rf_allocVector(INTSXP, n), &n_prot);
+
+  int* p_group = INTEGER(group);
+  int* p_out_starts = INTEGER(out_starts);
+  int* p_out_stops = INTEGER(out_stops);
+
+  for (int i = min_iteration, j = 0; i < max_iteration; ++i, ++j) {
+    int start;
+    int stop;
+
+    locate_window(window, &index, range, i, &start, &stop);
+
+    p_group[j] = i + 1;
+    p_out_starts[j] = start + 1;
+    p_out_stops[j] = stop + 1;
+  }
+
+  SEXP out = PROTECT_N(Rf_allocVector(VECSXP, 3), &n_prot);
+  SET_VECTOR_ELT(out, 0, group);
+  SET_VECTOR_ELT(out, 1, out_starts);
+  SET_VECTOR_ELT(out, 2, out_stops);
+
+  SEXP names = PROTECT_N(Rf_allocVector(STRSXP, 3), &n_prot);
+  SET_STRING_ELT(names, 0, Rf_mkChar("group"));
+  SET_STRING_ELT(names, 1, Rf_mkChar("start"));
+  SET_STRING_ELT(names, 2, Rf_mkChar("stop"));
+  Rf_setAttrib(out, R_NamesSymbol, names);
+
+  UNPROTECT(n_prot);
+  return out;
+}
+
+// Like `slide_index_windows_impl()`, but `i` holds the unique values of
+// several groups back to back, with `sizes` holding the number of unique
+// values in each group. Every group is walked on its own, in a single pass
+// over `i`, so windows never cross group boundaries and `complete` applies
+// to the edges of each group. On top of `group`, `start`, and `stop`, returns
+// `breaks`, the 0-based offsets of the windows of each group in the output,
+// with one extra element holding the total number of windows.
+
+// [[ register() ]]
+SEXP slide_index_grouped_windows_impl(SEXP i,
+                                      SEXP starts,
+                                      SEXP stops,
+                                      SEXP indices,
+                                      SEXP sizes,
+                                      SEXP complete_) {
+  int n_prot = 0;
+
+  const bool complete = r_scalar_lgl_get(complete_);
+
+  const int n_groups = Rf_length(sizes);
+  const int* p_sizes = INTEGER_RO(sizes);
+
+  struct window_index index = new_index_info(i);
+  const int i_size = index.size;
+
+  int* window_sizes = (int*) R_alloc(i_size, sizeof(int));
+  int* window_starts = (int*) R_alloc(i_size, sizeof(int));
+  int* window_stops = (int*) R_alloc(i_size, sizeof(int));
+
+  fill_window_info(window_sizes, window_starts, window_stops, indices, i_size);
+
+  struct window_info window = new_window_info(window_starts, window_stops, i_size);
+  PROTECT_WINDOW_INFO(&window, &n_prot);
+
+  struct window_range range = new_range_info(starts, stops, i_size);
+
+  // At most one window per unique value
+  int* p_group = (int*) R_alloc(i_size, sizeof(int));
+  int* p_out_starts = (int*) R_alloc(i_size, sizeof(int));
+  int* p_out_stops = (int*) R_alloc(i_size, sizeof(int));
+
+  SEXP breaks = PROTECT_N(Rf_allocVector(INTSXP, n_groups + 1), &n_prot);
+  int* p_breaks = INTEGER(breaks);
+
+  int from = 0;
+  int j = 0;
+
+  for (int g = 0; g < n_groups; ++g) {
+    if (g % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    p_breaks[g] = j;
+
+    window_restrict(&index, &range, from, p_sizes[g]);
+
+    const int min_iteration = window_min_iteration(index, range, complete);
+    const int max_iteration = window_max_iteration(index, range, complete);
+
+    for (int pos = min_iteration; pos < max_iteration; ++pos, ++j) {
+      int start;
+      int stop;
+
+      locate_window(window, &index, range, pos, &start, &stop);
+
+      p_group[j] = pos + 1;
+      p_out_starts[j] = start + 1;
+      p_out_stops[j] = stop + 1;
+    }
+
+    from += p_sizes[g];
+  }
+
+  p_breaks[n_groups] = j;
+
+  SEXP group = PROTECT_N(Rf_allocVector(INTSXP, j), &n_prot);
+  SEXP out_starts = PROTECT_N(Rf_allocVector(INTSXP, j), &n_prot);
+  SEXP out_stops = PROTECT_N(Rf_allocVector(INTSXP, j), &n_prot);
+
+  memcpy(INTEGER(group), p_group, j * sizeof(int));
+  memcpy(INTEGER(out_starts), p_out_starts, j * sizeof(int));
+  memcpy(INTEGER(out_stops), p_out_stops, j * sizeof(int));
+
+  SEXP out = PROTECT_N(Rf_allocVector(VECSXP, 4), &n_prot);
+  SET_VECTOR_ELT(out, 0, group);
+  SET_VECTOR_ELT(out, 1, out_starts);
+  SET_VECTOR_ELT(out, 2, out_stops);
+  SET_VECTOR_ELT(out, 3, breaks);
+
+  SEXP names = PROTECT_N(Rf_allocVector(STRSXP, 4), &n_prot);
+  SET_STRING_ELT(names, 0, Rf_mkChar("group"));
+  SET_STRING_ELT(names, 1, Rf_mkChar("start"));
+  SET_STRING_ELT(names, 2, Rf_mkChar("stop"));
+  SET_STRING_ELT(names, 3, Rf_mkChar("breaks"));
+  Rf_setAttrib(out, R_NamesSymbol, names);
+
+  UNPROTECT(n_prot);
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
 #define HOP_INDEX_LOOP(ASSIGN_ONE) do {                        \
   for (int i = 0; i < range.size; ++i) {                       \
     if (i % 1024 == 0) {                                       \
       R_CheckUserInterrupt();                                  \
     }                                                          \
                                                                \
-    increment_window(window, &index, range, i);                \
-    slice_and_update_env(x, window.seq, env, type, container); \
+    /* Skipped locations keep their initialised value */       \
+    if (p_where != NULL && !p_where[i]) {                      \
+      continue;                                                \
+    }                                                          \
                                                                \
-    SEXP elt = PROTECT(r_force_eval(f_call, env, force));      \
+    SEXP elt = PROTECT(eval_window(                            \
+      &cache, window, &index, range, i,                        \
+      x, f_call, env, type, force, container                   \
+    ));                                                        \
                                                                \
     if (atomic && vec_size(elt) != 1) {                        \
       stop_not_all_size_one(i + 1, vec_size(elt));             \
@@ -192,7 +409,9 @@ SEXP hop_index_common_impl(SEXP x,
                            SEXP type_,
                            SEXP constrain_,
                            SEXP atomic_,
-                           SEXP size_) {
+                           SEXP size_,
+                           SEXP reuse_,
+                           SEXP where) {
   int n_prot = 0;
 
   const int type = r_scalar_int_get(type_);
@@ -200,9 +419,13 @@ SEXP hop_index_common_impl(SEXP x,
   const bool constrain = r_scalar_lgl_get(constrain_);
   const bool atomic = r_scalar_lgl_get(atomic_);
   const int size = r_scalar_int_get(size_);
+  const bool reuse = r_scalar_lgl_get(reuse_);
+
+  // Either `NULL`, or a logical vector the size of the range. The index
+  // still advances for every range, but `.f` is only called where it is `TRUE`.
+  const int* p_where = (where == R_NilValue) ? NULL : LOGICAL_RO(where);
 
-  struct index_info index = new_index_info(i);
-  PROTECT_INDEX_INFO(&index, &n_prot);
+  struct window_index index = new_index_info(i);
 
   int* window_sizes = (int*) R_alloc(index.size, sizeof(int));
   int* window_starts = (int*) R_alloc(index.size, sizeof(int));
@@ -213,11 +436,13 @@ SEXP hop_index_common_impl(SEXP x,
   struct window_info window = new_window_info(window_starts, window_stops, index.size);
   PROTECT_WINDOW_INFO(&window, &n_prot);
 
-  struct range_info range = new_range_info(starts, stops, size);
-  PROTECT_RANGE_INFO(&range, &n_prot);
+  struct window_range range = new_range_info(starts, stops, size);
 
   SEXP container = PROTECT_N(make_slice_container(type), &n_prot);
 
+  SEXP cache_results = PROTECT_N(Rf_allocVector(VECSXP, 2), &n_prot);
+  struct window_cache cache = new_window_cache(reuse, cache_results);
+
   SEXPTYPE out_type = TYPEOF(ptype);
   SEXP out = PROTECT_N(slider_init(out_type, size), &n_prot);
 
@@ -255,98 +480,31 @@ static struct window_info new_window_info(int* window_starts, int* window_stops,
 
 // -----------------------------------------------------------------------------
 
-static struct index_info new_index_info(SEXP i) {
-  struct index_info index;
-
-  index.data = i;
-  index.size = vec_size(i);
-  index.last_pos = index.size - 1;
-
-  index.current_start_pos = 0;
-  index.current_stop_pos = 0;
-
-  index.compare_lt = get_compare_fn_lt(i);
-  index.compare_gt = get_compare_fn_gt(i);
-  index.compare_lte = get_compare_fn_lte(i);
-
-  return index;
+// The index and range are handed to the window engine as typed pointers
+// where possible, see `get_window_compare_data()`. The engine doesn't
+// protect anything, but `i`, `starts`, and `stops` are arguments of the
+// `.Call()`, so they stay protected for the duration of it.
+
+static struct window_index new_index_info(SEXP i) {
+  return new_window_index(
+    get_window_compare_data(i),
+    vec_size(i),
+    get_window_compare_fn(i)
+  );
 }
 
 // -----------------------------------------------------------------------------
 
-static struct range_info new_range_info(SEXP starts, SEXP stops, int size) {
-  struct range_info range;
-
-  range.starts = starts;
-  range.stops = stops;
-
-  range.start_unbounded = (starts == R_NilValue);
-  range.stop_unbounded = (stops == R_NilValue);
-
-  if (!range.start_unbounded && !range.stop_unbounded) {
+static struct window_range new_range_info(SEXP starts, SEXP stops, int size) {
+  if (starts != R_NilValue && stops != R_NilValue) {
     check_slide_starts_not_past_stops(starts, stops);
   }
 
-  range.size = size;
-
-  return range;
-}
-
-// -----------------------------------------------------------------------------
-
-static int iteration_min_adjustment(struct index_info index, SEXP range, int size);
-static int iteration_max_adjustment(struct index_info index, SEXP range, int size);
-
-static int compute_min_iteration(struct index_info index, struct range_info range, bool complete) {
-  int out = 0;
-
-  if (!complete || range.start_unbounded) {
-    return out;
-  }
-
-  out += iteration_min_adjustment(index, range.starts, range.size);
-
-  return out;
-}
-
-static int compute_max_iteration(struct index_info index, struct range_info range, bool complete) {
-  int out = range.size;
-
-  if (!complete || range.stop_unbounded) {
-    return out;
-  }
-
-  out -= iteration_max_adjustment(index, range.stops, range.size);
-
-  return out;
-}
-
-static int iteration_min_adjustment(struct index_info index, SEXP range, int size) {
-  int forward_adjustment = 0;
-
-  for (int j = 0; j < size; ++j) {
-    if (index.compare_gt(index.data, 0, range, j)) {
-      ++forward_adjustment;
-    } else {
-      break;
-    }
-  }
-
-  return forward_adjustment;
-}
-
-static int iteration_max_adjustment(struct index_info index, SEXP range, int size) {
-  int backward_adjustment = 0;
-
-  for (int j = size - 1; j >= 0; --j) {
-    if (index.compare_lt(index.data, index.last_pos, range, j)) {
-      ++backward_adjustment;
-    } else {
-      break;
-    }
-  }
-
-  return backward_adjustment;
+  return new_window_range(
+    get_window_compare_data(starts),
+    get_window_compare_data(stops),
+    size
+  );
 }
 
 // -----------------------------------------------------------------------------
@@ -370,76 +528,96 @@ static void fill_window_info(int* window_sizes,
 }
 
 // -----------------------------------------------------------------------------
-// `index` is passed by pointer so we can permanently
-// update the current start/stop position
 
-static int locate_window_starts_pos(struct index_info* index, struct range_info range, int pos) {
-  // Pin to the start
-  if (range.start_unbounded) {
-    return 0;
-  }
+// Locate the 0-based `[start, stop]` range of `x` that makes up the window
+// at `pos`. Empty windows are signaled with `start = 0` and `stop = -1`.
+static void locate_window(struct window_info window,
+                          struct window_index* index,
+                          struct window_range range,
+                          int pos,
+                          int* p_start,
+                          int* p_stop) {
+  int starts_pos;
+  int stops_pos;
 
-  // Past the end? Signal OOB with `last_pos + 1`.
-  // This also handles size zero `.i` with `.starts` / `.stops` that have size.
-  // Current pos will be 0, but `last_pos` will be -1.
-  if (index->current_start_pos > index->last_pos) {
-    return index->last_pos + 1;
-  }
-
-  while (index->compare_lt(index->data, index->current_start_pos, range.starts, pos)) {
-    ++index->current_start_pos;
+  window_locate(index, range, pos, &starts_pos, &stops_pos);
 
-    // Past the end? Signal OOB with `last_pos + 1`.
-    if (index->current_start_pos > index->last_pos) {
-      return index->last_pos + 1;
-    }
+  if (stops_pos < starts_pos) {
+    *p_start = 0;
+    *p_stop = -1;
+    return;
   }
 
-  return index->current_start_pos;
+  *p_start = window.starts[starts_pos];
+  *p_stop = window.stops[stops_pos];
 }
 
-static int locate_window_stops_pos(struct index_info* index, struct range_info range, int pos) {
-  // Pin to the end
-  if (range.stop_unbounded) {
-    return index->last_pos;
-  }
-
-  // Past the end? Pin to end.
-  // This also handles size zero `.i` with `.starts` / `.stops` that have size.
-  // Current pos will be 0, but `last_pos` will be -1.
-  if (index->current_stop_pos > index->last_pos) {
-    return index->last_pos;
-  }
+// -----------------------------------------------------------------------------
 
-  while (index->compare_lte(index->data, index->current_stop_pos, range.stops, pos)) {
-    ++index->current_stop_pos;
+static struct window_cache new_window_cache(bool enabled, SEXP results) {
+  return (struct window_cache) {
+    .enabled = enabled,
+    .start = 0,
+    .stop = -1,
+    .has_last = false,
+    .has_empty = false,
+    .results = results
+  };
+}
 
-    // Past the end? Pin to end.
-    if (index->current_stop_pos > index->last_pos) {
-      return index->last_pos;
+// Evaluate `f_call` on the window at `pos`. With sparse indices, consecutive
+// windows often cover the exact same range of `x`, in which case the result
+// of the previous window is reused rather than slicing `x` and calling `.f`
+// again. The result of an empty window is computed once and reused for every
+// empty window. Reuse assumes that `.f` is pure, so it can be turned off.
+// The returned value is not protected.
+static SEXP eval_window(struct window_cache* p_cache,
+                        struct window_info window,
+                        struct window_index* index,
+                        struct window_range range,
+                        int pos,
+                        SEXP x,
+                        SEXP f_call,
+                        SEXP env,
+                        int type,
+                        int force,
+                        SEXP container) {
+  int start;
+  int stop;
+
+  locate_window(window, index, range, pos, &start, &stop);
+
+  const bool empty = stop < start;
+
+  if (p_cache->enabled) {
+    if (empty && p_cache->has_empty) {
+      return VECTOR_ELT(p_cache->results, 1);
+    }
+    if (p_cache->has_last && start == p_cache->start && stop == p_cache->stop) {
+      return VECTOR_ELT(p_cache->results, 0);
     }
   }
 
-  return index->current_stop_pos - 1;
-}
+  int size = stop - start + 1;
 
-// -----------------------------------------------------------------------------
+  init_compact_seq(window.p_seq_val, start, size, true);
+  slice_and_update_env(x, window.seq, env, type, container);
 
-static void increment_window(struct window_info window,
-                             struct index_info* index,
-                             struct range_info range,
-                             int pos) {
-  int starts_pos = locate_window_starts_pos(index, range, pos);
-  int stops_pos = locate_window_stops_pos(index, range, pos);
+  SEXP out = r_force_eval(f_call, env, force);
 
-  if (stops_pos < starts_pos) {
-    init_compact_seq(window.p_seq_val, 0, 0, true);
-    return;
+  if (!p_cache->enabled) {
+    return out;
   }
 
-  int start = window.starts[starts_pos];
-  int stop = window.stops[stops_pos];
-  int size = stop - start + 1;
+  if (empty) {
+    SET_VECTOR_ELT(p_cache->results, 1, out);
+    p_cache->has_empty = true;
+  } else {
+    SET_VECTOR_ELT(p_cache->results, 0, out);
+    p_cache->start = start;
+    p_cache->stop = stop;
+    p_cache->has_last = true;
+  }
 
-  init_compact_seq(window.p_seq_val, start, size, true);
+  return out;
 }
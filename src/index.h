@@ -2,10 +2,12 @@
 #define SLIDER_INDEX_H
 
 #include "slider.h"
-#include "compare.h"
+#include "window.h"
 
 // -----------------------------------------------------------------------------
 
+// The locations in `x` of the values of the index. Values are unique, and
+// the elements of `x` that hold value `i` run from `starts[i]` to `stops[i]`.
 struct window_info {
   int* starts;
   int* stops;
@@ -18,40 +20,4 @@ struct window_info {
   *n += 1;                                   \
 } while (0)
 
-// -----------------------------------------------------------------------------
-
-struct index_info {
-  SEXP data;
-  int size;
-  int last_pos;
-  int current_start_pos;
-  int current_stop_pos;
-  slider_compare_fn_t compare_lt;
-  slider_compare_fn_t compare_gt;
-  slider_compare_fn_t compare_lte;
-};
-
-#define PROTECT_INDEX_INFO(index, n) do {  \
-  PROTECT((index)->data);                  \
-  *n += 1;                                 \
-} while (0)
-
-// -----------------------------------------------------------------------------
-
-struct range_info {
-  SEXP starts;
-  SEXP stops;
-  int size;
-  bool start_unbounded;
-  bool stop_unbounded;
-};
-
-#define PROTECT_RANGE_INFO(range, n) do { \
-  PROTECT((range)->starts);               \
-  PROTECT((range)->stops);                \
-  *n += 2;                                \
-} while (0)
-
-// -----------------------------------------------------------------------------
-
 #endif
@@ -2,13 +2,44 @@
 #include <Rinternals.h>
 #include <stdlib.h> // for NULL
 #include <R_ext/Rdynload.h>
+#include <stdbool.h>
+#include <slider-api.h>
 
 /* .Call calls */
-extern SEXP slide_common_impl(SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slide_common_impl(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP hop_common_impl(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
-extern SEXP slide_index_common_impl(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
-extern SEXP hop_index_common_impl(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
-extern SEXP slider_block(SEXP, SEXP, SEXP);
+extern SEXP slide_index_common_impl(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP hop_index_common_impl(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slide_windows_impl(SEXP, SEXP);
+extern SEXP slide_index_windows_impl(SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slide_grouped_windows_impl(SEXP, SEXP);
+extern SEXP slide_index_grouped_windows_impl(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_block(SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_block_summarise(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_hop_summarise(SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_batch_matrix(SEXP, SEXP, SEXP);
+extern SEXP slider_accumulate_impl(SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_aggregate_r(SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_aggregate_native(SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_aggregate_weighted(SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_new_aggregator_native(SEXP, SEXP, SEXP);
+extern SEXP slider_combine_r(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_combine_native(SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_new_combiner_native(SEXP, SEXP, SEXP);
+extern SEXP slider_kernel_sizes(void);
+extern SEXP slider_slide_columns(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_aggregate_groups(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_slide_widths(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_slide_summarise(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_sketch_quantile(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_slide_rank(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_slide_top_k(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_slide_histogram(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_slide_weighted(SEXP, SEXP, SEXP, SEXP);
+extern SEXP slider_session_distance(SEXP, SEXP, SEXP);
+extern SEXP slider_session_boundary(SEXP, SEXP, SEXP);
+extern SEXP slider_window_join(SEXP, SEXP, SEXP);
+extern SEXP slider_window_position(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP slider_compute_from(SEXP, SEXP, SEXP, SEXP);
 extern SEXP slider_compute_to(SEXP, SEXP, SEXP, SEXP);
 extern SEXP slider_vec_set_names(SEXP, SEXP);
@@ -17,12 +48,53 @@ extern SEXP slider_vec_names(SEXP);
 // Defined below
 SEXP slider_initialize(SEXP);
 
+// block.c
+void slider_initialize_block(DllInfo*);
+
+// kernels.c
+void slider_initialize_kernels(DllInfo*);
+
+/* C callables, see `inst/include/slider-api.h` */
+extern int api_slide_windows(int, int, bool, int, bool, int, bool, int*, int*, int*);
+extern int api_index_windows(const double*, int, double, bool, double, bool, bool, int*, int*, int*);
+extern void api_aggregate(const struct slider_aggregator*, const double*, R_xlen_t, const int*, const int*, R_xlen_t, double*);
+extern void api_combine(const struct slider_combiner*, const double*, R_xlen_t, const int*, const int*, R_xlen_t, double*);
+
 static const R_CallMethodDef CallEntries[] = {
-  {"slide_common_impl",         (DL_FUNC) &slide_common_impl, 5},
+  {"slide_common_impl",         (DL_FUNC) &slide_common_impl, 6},
   {"hop_common_impl",           (DL_FUNC) &hop_common_impl, 7},
-  {"slide_index_common_impl",   (DL_FUNC) &slide_index_common_impl, 13},
-  {"hop_index_common_impl",     (DL_FUNC) &hop_index_common_impl, 12},
-  {"slider_block",              (DL_FUNC) &slider_block, 3},
+  {"slide_index_common_impl",   (DL_FUNC) &slide_index_common_impl, 15},
+  {"hop_index_common_impl",     (DL_FUNC) &hop_index_common_impl, 14},
+  {"slide_windows_impl",        (DL_FUNC) &slide_windows_impl, 2},
+  {"slide_index_windows_impl",  (DL_FUNC) &slide_index_windows_impl, 5},
+  {"slide_grouped_windows_impl", (DL_FUNC) &slide_grouped_windows_impl, 2},
+  {"slide_index_grouped_windows_impl", (DL_FUNC) &slide_index_grouped_windows_impl, 6},
+  {"slider_block",              (DL_FUNC) &slider_block, 4},
+  {"slider_block_summarise",    (DL_FUNC) &slider_block_summarise, 6},
+  {"slider_hop_summarise",      (DL_FUNC) &slider_hop_summarise, 5},
+  {"slider_batch_matrix",       (DL_FUNC) &slider_batch_matrix, 3},
+  {"slider_accumulate_impl",    (DL_FUNC) &slider_accumulate_impl, 5},
+  {"slider_aggregate_r",        (DL_FUNC) &slider_aggregate_r, 5},
+  {"slider_aggregate_native",   (DL_FUNC) &slider_aggregate_native, 4},
+  {"slider_aggregate_weighted", (DL_FUNC) &slider_aggregate_weighted, 5},
+  {"slider_new_aggregator_native", (DL_FUNC) &slider_new_aggregator_native, 3},
+  {"slider_combine_r",          (DL_FUNC) &slider_combine_r, 6},
+  {"slider_combine_native",     (DL_FUNC) &slider_combine_native, 4},
+  {"slider_new_combiner_native", (DL_FUNC) &slider_new_combiner_native, 3},
+  {"slider_kernel_sizes",       (DL_FUNC) &slider_kernel_sizes, 0},
+  {"slider_slide_columns",      (DL_FUNC) &slider_slide_columns, 7},
+  {"slider_aggregate_groups",   (DL_FUNC) &slider_aggregate_groups, 7},
+  {"slider_slide_widths",       (DL_FUNC) &slider_slide_widths, 6},
+  {"slider_slide_summarise",    (DL_FUNC) &slider_slide_summarise, 7},
+  {"slider_sketch_quantile",    (DL_FUNC) &slider_sketch_quantile, 9},
+  {"slider_slide_rank",         (DL_FUNC) &slider_slide_rank, 7},
+  {"slider_slide_top_k",        (DL_FUNC) &slider_slide_top_k, 7},
+  {"slider_slide_histogram",    (DL_FUNC) &slider_slide_histogram, 6},
+  {"slider_slide_weighted",     (DL_FUNC) &slider_slide_weighted, 4},
+  {"slider_session_distance",   (DL_FUNC) &slider_session_distance, 3},
+  {"slider_session_boundary",   (DL_FUNC) &slider_session_boundary, 3},
+  {"slider_window_join",        (DL_FUNC) &slider_window_join, 3},
+  {"slider_window_position",    (DL_FUNC) &slider_window_position, 6},
   {"slider_compute_from",       (DL_FUNC) &slider_compute_from, 4},
   {"slider_compute_to",         (DL_FUNC) &slider_compute_to, 4},
   {"slider_vec_set_names",      (DL_FUNC) &slider_vec_set_names, 2},
@@ -35,6 +107,14 @@ void R_init_slider(DllInfo *dll)
 {
   R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
   R_useDynamicSymbols(dll, FALSE);
+
+  R_RegisterCCallable("slider", "slider_slide_windows", (DL_FUNC) &api_slide_windows);
+  R_RegisterCCallable("slider", "slider_index_windows", (DL_FUNC) &api_index_windows);
+  R_RegisterCCallable("slider", "slider_aggregate",     (DL_FUNC) &api_aggregate);
+  R_RegisterCCallable("slider", "slider_combine",       (DL_FUNC) &api_combine);
+
+  slider_initialize_block(dll);
+  slider_initialize_kernels(dll);
 }
 
 // slider-vctrs-private.c
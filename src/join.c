@@ -0,0 +1,88 @@
+#include "slider.h"
+#include "slider-vctrs.h"
+#include "compare.h"
+
+// -----------------------------------------------------------------------------
+// Window joins
+//
+// Every probe window `[starts[j], stops[j]]` is located in the ascending
+// index `i`, returning the 1-based locations of the first and last element
+// of `i` that fall in it. When the probes are sorted, which is the common
+// case of joining two time ordered tables, the cursors of the window engine
+// locate every window in a single merge-like pass over `i`. Otherwise, each
+// window is located with a binary search over `i`, so the probes don't have
+// to be sorted up front.
+
+static bool window_range_is_ascending(struct window_range range, window_compare_fn compare) {
+  for (int j = 1; j < range.size; ++j) {
+    if (!range.start_unbounded && compare(range.starts, j - 1, range.starts, j) > 0) {
+      return false;
+    }
+    if (!range.stop_unbounded && compare(range.stops, j - 1, range.stops, j) > 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// `i`, `starts`, and `stops` are comparison proxies of a common type, where
+// `starts` and `stops` have already been recycled to a common size. Empty
+// windows have `stop < start`.
+
+// [[ register() ]]
+SEXP slider_window_join(SEXP i, SEXP starts, SEXP stops) {
+  const int size = vec_size(starts);
+
+  const window_compare_fn compare = get_window_compare_fn(i);
+
+  struct window_index index = new_window_index(
+    get_window_compare_data(i),
+    vec_size(i),
+    compare
+  );
+
+  struct window_range range = new_window_range(
+    get_window_compare_data(starts),
+    get_window_compare_data(stops),
+    size
+  );
+
+  const bool ascending = window_range_is_ascending(range, compare);
+
+  SEXP out_starts = PROTECT(Rf_allocVector(INTSXP, size));
+  SEXP out_stops = PROTECT(Rf_allocVector(INTSXP, size));
+
+  int* p_out_starts = INTEGER(out_starts);
+  int* p_out_stops = INTEGER(out_stops);
+
+  for (int j = 0; j < size; ++j) {
+    if (j % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    int start_pos;
+    int stop_pos;
+
+    if (ascending) {
+      window_locate(&index, range, j, &start_pos, &stop_pos);
+    } else {
+      window_search(&index, range, j, &start_pos, &stop_pos);
+    }
+
+    p_out_starts[j] = start_pos + 1;
+    p_out_stops[j] = stop_pos + 1;
+  }
+
+  SEXP out = PROTECT(Rf_allocVector(VECSXP, 2));
+  SET_VECTOR_ELT(out, 0, out_starts);
+  SET_VECTOR_ELT(out, 1, out_stops);
+
+  SEXP names = PROTECT(Rf_allocVector(STRSXP, 2));
+  SET_STRING_ELT(names, 0, Rf_mkChar("start"));
+  SET_STRING_ELT(names, 1, Rf_mkChar("stop"));
+  Rf_setAttrib(out, R_NamesSymbol, names);
+
+  UNPROTECT(4);
+  return out;
+}
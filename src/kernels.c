@@ -0,0 +1,174 @@
+#include "slider.h"
+#include "aggregate.h"
+#include "summary.h"
+
+// -----------------------------------------------------------------------------
+// Built-in kernels
+//
+// These are native aggregators and combiners that slider registers as C
+// callables, and then adds to the kernel registry in `.onLoad()`, exactly
+// like another package would register its own kernels. Missing values are
+// counted rather than added, so that they propagate to the result of every
+// window that contains them without poisoning the running sum.
+
+struct sum_state {
+  long double sum;
+  R_xlen_t n;
+  R_xlen_t n_missing;
+};
+
+static void kernel_sum_init(void* state) {
+  struct sum_state* p_state = (struct sum_state*) state;
+  p_state->sum = 0;
+  p_state->n = 0;
+  p_state->n_missing = 0;
+}
+
+static void kernel_sum_add(void* state, double x) {
+  struct sum_state* p_state = (struct sum_state*) state;
+
+  if (ISNAN(x)) {
+    ++p_state->n_missing;
+  } else {
+    p_state->sum += x;
+    ++p_state->n;
+  }
+}
+
+static void kernel_sum_remove(void* state, double x) {
+  struct sum_state* p_state = (struct sum_state*) state;
+
+  if (ISNAN(x)) {
+    --p_state->n_missing;
+  } else {
+    p_state->sum -= x;
+    --p_state->n;
+  }
+}
+
+static double kernel_sum_finalize(const void* state) {
+  const struct sum_state* p_state = (const struct sum_state*) state;
+
+  if (p_state->n_missing != 0) {
+    return NA_REAL;
+  }
+
+  return (double) p_state->sum;
+}
+
+static double kernel_mean_finalize(const void* state) {
+  const struct sum_state* p_state = (const struct sum_state*) state;
+
+  if (p_state->n_missing != 0) {
+    return NA_REAL;
+  }
+  if (p_state->n == 0) {
+    return R_NaN;
+  }
+
+  return (double) (p_state->sum / p_state->n);
+}
+
+// -----------------------------------------------------------------------------
+
+static void kernel_extreme_lift(void* value, double x) {
+  *((double*) value) = x;
+}
+
+static void kernel_min_combine(void* out, const void* a, const void* b) {
+  const double x = *((const double*) a);
+  const double y = *((const double*) b);
+
+  if (ISNAN(x)) {
+    *((double*) out) = x;
+  } else if (ISNAN(y)) {
+    *((double*) out) = y;
+  } else {
+    *((double*) out) = x < y ? x : y;
+  }
+}
+
+static void kernel_max_combine(void* out, const void* a, const void* b) {
+  const double x = *((const double*) a);
+  const double y = *((const double*) b);
+
+  if (ISNAN(x)) {
+    *((double*) out) = x;
+  } else if (ISNAN(y)) {
+    *((double*) out) = y;
+  } else {
+    *((double*) out) = x > y ? x : y;
+  }
+}
+
+static double kernel_extreme_finalize(const void* value) {
+  return *((const double*) value);
+}
+
+// -----------------------------------------------------------------------------
+
+// The built-in kernels are recognized by their callables rather than by the
+// name they are registered under, as a package is free to register its own
+// kernel as `"sum"`. Returns the `summary_stat` that the kernel behind
+// `pointer` computes, or `-1` if it isn't one of the built-in kernels.
+
+// [[ include("summary.h") ]]
+int kernel_summary_stat(SEXP pointer, bool combiner) {
+  if (combiner) {
+    const struct slider_combiner* p_combiner = slider_combiner_deref(pointer);
+
+    if (p_combiner->lift != &kernel_extreme_lift ||
+        p_combiner->finalize != &kernel_extreme_finalize) {
+      return -1;
+    }
+    if (p_combiner->combine == &kernel_min_combine) {
+      return SUMMARY_STAT_MIN;
+    }
+    if (p_combiner->combine == &kernel_max_combine) {
+      return SUMMARY_STAT_MAX;
+    }
+
+    return -1;
+  }
+
+  const struct slider_aggregator* p_aggregator = slider_aggregator_deref(pointer);
+
+  if (p_aggregator->init != &kernel_sum_init ||
+      p_aggregator->add != &kernel_sum_add ||
+      p_aggregator->remove != &kernel_sum_remove) {
+    return -1;
+  }
+  if (p_aggregator->finalize == &kernel_sum_finalize) {
+    return SUMMARY_STAT_SUM;
+  }
+  if (p_aggregator->finalize == &kernel_mean_finalize) {
+    return SUMMARY_STAT_MEAN;
+  }
+
+  return -1;
+}
+
+// -----------------------------------------------------------------------------
+
+// [[ register() ]]
+SEXP slider_kernel_sizes(void) {
+  SEXP out = PROTECT(Rf_allocVector(INTSXP, 2));
+  INTEGER(out)[0] = (int) sizeof(struct sum_state);
+  INTEGER(out)[1] = (int) sizeof(double);
+  UNPROTECT(1);
+  return out;
+}
+
+// [[ register() ]]
+void slider_initialize_kernels(DllInfo* dll) {
+  R_RegisterCCallable("slider", "slider_kernel_sum_init",      (DL_FUNC) &kernel_sum_init);
+  R_RegisterCCallable("slider", "slider_kernel_sum_add",       (DL_FUNC) &kernel_sum_add);
+  R_RegisterCCallable("slider", "slider_kernel_sum_remove",    (DL_FUNC) &kernel_sum_remove);
+  R_RegisterCCallable("slider", "slider_kernel_sum_finalize",  (DL_FUNC) &kernel_sum_finalize);
+  R_RegisterCCallable("slider", "slider_kernel_mean_finalize", (DL_FUNC) &kernel_mean_finalize);
+
+  R_RegisterCCallable("slider", "slider_kernel_extreme_lift",     (DL_FUNC) &kernel_extreme_lift);
+  R_RegisterCCallable("slider", "slider_kernel_min_combine",      (DL_FUNC) &kernel_min_combine);
+  R_RegisterCCallable("slider", "slider_kernel_max_combine",      (DL_FUNC) &kernel_max_combine);
+  R_RegisterCCallable("slider", "slider_kernel_extreme_finalize", (DL_FUNC) &kernel_extreme_finalize);
+}
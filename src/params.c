@@ -146,9 +146,18 @@ int pull_complete(SEXP params) {
 
 // -----------------------------------------------------------------------------
 
+// Turn a `window_status` from the window engine into an error
+
 // [[ include("params.h") ]]
-void check_double_negativeness(int before, int after, bool before_positive, bool after_positive) {
-  if (!before_positive && !after_positive) {
+void stop_window_status(enum window_status status, int before, int after, int step) {
+  switch (status) {
+  case WINDOW_OK: {
+    return;
+  }
+  case WINDOW_ERROR_STEP: {
+    Rf_errorcall(R_NilValue, "`.step` must be at least 1, not %i.", step);
+  }
+  case WINDOW_ERROR_DOUBLE_NEGATIVE: {
     Rf_errorcall(
       R_NilValue,
       "`.before` (%i) and `.after` (%i) cannot both be negative.",
@@ -156,50 +165,25 @@ void check_double_negativeness(int before, int after, bool before_positive, bool
       after
     );
   }
-}
-
-// [[ include("params.h") ]]
-void check_after_negativeness(int after, int before, bool after_positive, bool before_unbounded) {
-  if (after_positive) {
-    return;
-  }
-
-  if (before_unbounded) {
-    return;
+  case WINDOW_ERROR_BEFORE_NEGATIVE: {
+    Rf_errorcall(
+      R_NilValue,
+      "When `.before` (%i) is negative, it's absolute value (%i) cannot be greater than `.after` (%i).",
+      before,
+      abs(before),
+      after
+    );
   }
-
-  int abs_after = abs(after);
-
-  if (abs_after > before) {
+  case WINDOW_ERROR_AFTER_NEGATIVE: {
     Rf_errorcall(
       R_NilValue,
       "When `.after` (%i) is negative, it's absolute value (%i) cannot be greater than `.before` (%i).",
       after,
-      abs_after,
+      abs(after),
       before
     );
   }
-}
-
-// [[ include("params.h") ]]
-void check_before_negativeness(int before, int after, bool before_positive, bool after_unbounded) {
-  if (before_positive) {
-    return;
-  }
-
-  if (after_unbounded) {
-    return;
   }
 
-  int abs_before = abs(before);
-
-  if (abs_before > after) {
-    Rf_errorcall(
-      R_NilValue,
-      "When `.before` (%i) is negative, it's absolute value (%i) cannot be greater than `.after` (%i).",
-      before,
-      abs_before,
-      after
-    );
-  }
+  never_reached("stop_window_status");
 }
@@ -2,6 +2,7 @@
 #define SLIDER_PARAMS_H
 
 #include "slider.h"
+#include "window.h"
 
 int pull_type(SEXP params);
 bool pull_constrain(SEXP params);
@@ -11,8 +12,6 @@ int pull_after(SEXP params, bool* after_unbounded);
 int pull_step(SEXP params);
 int pull_complete(SEXP params);
 
-void check_double_negativeness(int before, int after, bool before_positive, bool after_positive);
-void check_after_negativeness(int after, int before, bool after_positive, bool before_unbounded);
-void check_before_negativeness(int before, int after, bool before_positive, bool after_unbounded);
+void stop_window_status(enum window_status status, int before, int after, int step);
 
 #endif
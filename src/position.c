@@ -0,0 +1,122 @@
+#include "slider.h"
+#include "utils.h"
+
+// -----------------------------------------------------------------------------
+// Positional kernels
+//
+// Rather than aggregating the elements of a window, these locate a single
+// element of it, which is then sliced out of `x` on the R side, so they work
+// with vectors of any type. The first, last, and nth element of a window are
+// found from the window boundaries alone. The first and last non-missing
+// elements are found from the location of the next and previous non-missing
+// element of every location of `x`, which are computed once, so every window
+// is still answered in O(1), no matter how long the runs of missing values
+// are.
+
+enum window_position {
+  WINDOW_POSITION_FIRST = 0,
+  WINDOW_POSITION_LAST = 1,
+  WINDOW_POSITION_NTH = 2,
+  WINDOW_POSITION_FIRST_VALID = 3,
+  WINDOW_POSITION_LAST_VALID = 4
+};
+
+// `start` and `stop` are the 0-based boundaries of a non-empty window
+static inline int window_position_locate(enum window_position position,
+                                         int n,
+                                         int start,
+                                         int stop,
+                                         const int* p_next_valid,
+                                         const int* p_prev_valid) {
+  switch (position) {
+  case WINDOW_POSITION_FIRST: {
+    return start;
+  }
+  case WINDOW_POSITION_LAST: {
+    return stop;
+  }
+  case WINDOW_POSITION_NTH: {
+    // Negative `n` count back from the end of the window, like `dplyr::nth()`
+    const R_xlen_t loc = (n > 0) ? (R_xlen_t) start + n - 1 : (R_xlen_t) stop + n + 1;
+    return (loc < start || loc > stop) ? -1 : (int) loc;
+  }
+  case WINDOW_POSITION_FIRST_VALID: {
+    const int loc = p_next_valid[start];
+    return (loc > stop) ? -1 : loc;
+  }
+  case WINDOW_POSITION_LAST_VALID: {
+    const int loc = p_prev_valid[stop];
+    return (loc < start) ? -1 : loc;
+  }
+  }
+
+  never_reached("window_position_locate");
+}
+
+// `missing` is a logical vector the size of `x` holding whether each of its
+// elements is missing, and is only used by the non-missing positions.
+// `starts` and `stops` are the 1-based window boundaries, which are
+// restricted to the range of `x` here. Returns the
+// 1-based location of the element of each window, or `NA` when the window
+// has no such element.
+
+// [[ register() ]]
+SEXP slider_window_position(SEXP missing,
+                            SEXP starts,
+                            SEXP stops,
+                            SEXP x_size,
+                            SEXP position,
+                            SEXP n) {
+  const int x_size_ = r_scalar_int_get(x_size);
+  const enum window_position position_ = (enum window_position) r_scalar_int_get(position);
+  const int n_ = r_scalar_int_get(n);
+
+  const R_xlen_t size = Rf_xlength(starts);
+
+  const int* p_starts = INTEGER_RO(starts);
+  const int* p_stops = INTEGER_RO(stops);
+
+  const int* p_next_valid = NULL;
+  const int* p_prev_valid = NULL;
+
+  if (position_ == WINDOW_POSITION_FIRST_VALID || position_ == WINDOW_POSITION_LAST_VALID) {
+    int* p_next = (int*) R_alloc(x_size_, sizeof(int));
+    int* p_prev = (int*) R_alloc(x_size_, sizeof(int));
+
+    compute_valid_locations(LOGICAL_RO(missing), x_size_, p_next, p_prev);
+
+    p_next_valid = p_next;
+    p_prev_valid = p_prev;
+  }
+
+  SEXP out = PROTECT(Rf_allocVector(INTSXP, size));
+  int* p_out = INTEGER(out);
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    if (i % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    const int start = max(p_starts[i] - 1, 0);
+    const int stop = min(p_stops[i], x_size_) - 1;
+
+    if (stop < start) {
+      p_out[i] = NA_INTEGER;
+      continue;
+    }
+
+    const int loc = window_position_locate(
+      position_,
+      n_,
+      start,
+      stop,
+      p_next_valid,
+      p_prev_valid
+    );
+
+    p_out[i] = (loc == -1) ? NA_INTEGER : loc + 1;
+  }
+
+  UNPROTECT(1);
+  return out;
+}
@@ -0,0 +1,150 @@
+#include "slider.h"
+#include "utils.h"
+#include "aggregate.h"
+#include "fenwick.h"
+
+// -----------------------------------------------------------------------------
+// Rolling ranks
+//
+// The values of `x` are coordinate compressed on the R side, into integer
+// codes `1, ..., n_codes` that preserve their order. A Fenwick tree over the
+// codes counts the values currently in the window, so that the number of
+// values in the window that are smaller than, or equal to, any value can be
+// found in O(log(n_codes)). As the window slides, values that enter it are
+// added to the tree and values that leave it are removed, both also in
+// O(log(n_codes)).
+
+enum rank_ties {
+  RANK_TIES_AVERAGE = 0,
+  RANK_TIES_MIN = 1,
+  RANK_TIES_MAX = 2
+};
+
+// The rank of the value at `loc` among the values of the window `[lo, hi)`.
+// If the value isn't in its own window, it is ranked as if it were added to
+// the window.
+static inline double rank_compute(const struct fenwick* p_tree,
+                                  const int* p_codes,
+                                  R_xlen_t loc,
+                                  R_xlen_t lo,
+                                  R_xlen_t hi,
+                                  int n,
+                                  enum rank_ties ties,
+                                  bool percent) {
+  const int code = p_codes[loc];
+
+  if (code == NA_INTEGER) {
+    return NA_REAL;
+  }
+
+  const bool outside = loc < lo || loc >= hi;
+
+  const int n_less = fenwick_prefix(p_tree, code - 1);
+  const int n_equal = fenwick_prefix(p_tree, code) - n_less + outside;
+  const int n_total = n + outside;
+
+  double out;
+
+  switch (ties) {
+  case RANK_TIES_AVERAGE: out = n_less + (n_equal + 1) / 2.0; break;
+  case RANK_TIES_MIN: out = n_less + 1; break;
+  case RANK_TIES_MAX: out = n_less + n_equal; break;
+  default: never_reached("rank_compute");
+  }
+
+  if (percent) {
+    out /= n_total;
+  }
+
+  return out;
+}
+
+// The window walk of `aggregate_walk()`, which holds the values of the
+// window in `tree`, `n` of them
+struct rank_data {
+  struct fenwick tree;
+  int n;
+  const int* p_codes;
+  SEXP loc;
+  enum rank_ties ties;
+  bool percent;
+  double* p_out;
+};
+
+static void rank_add(void* data, R_xlen_t from, R_xlen_t to) {
+  struct rank_data* p_data = (struct rank_data*) data;
+  fenwick_update_range(&p_data->tree, p_data->p_codes, from, to, 1, &p_data->n);
+}
+
+static void rank_remove(void* data, R_xlen_t from, R_xlen_t to) {
+  struct rank_data* p_data = (struct rank_data*) data;
+  fenwick_update_range(&p_data->tree, p_data->p_codes, from, to, -1, &p_data->n);
+}
+
+static void rank_finalize(void* data, R_xlen_t i, R_xlen_t lo, R_xlen_t hi) {
+  struct rank_data* p_data = (struct rank_data*) data;
+
+  R_xlen_t n_locs;
+  const int* p_locs = aggregate_loc(p_data->loc, i, &n_locs);
+
+  for (R_xlen_t j = 0; j < n_locs; ++j) {
+    const R_xlen_t out_loc = p_locs[j] - 1;
+
+    p_data->p_out[out_loc] = rank_compute(
+      &p_data->tree,
+      p_data->p_codes,
+      out_loc,
+      lo,
+      hi,
+      p_data->n,
+      p_data->ties,
+      p_data->percent
+    );
+  }
+}
+
+// `codes` are the compressed values of `x`, with `NA` for missing values,
+// which are ignored. `starts`, `stops`, and `loc` are as for
+// `slider_slide_summarise()`, and the rank of the element of `x` at every
+// output location is computed among the values of its window. Returns a
+// double vector of size `size`, where locations without a window are `NA`.
+
+// [[ register() ]]
+SEXP slider_slide_rank(SEXP codes,
+                       SEXP n_codes,
+                       SEXP starts,
+                       SEXP stops,
+                       SEXP loc,
+                       SEXP ties,
+                       SEXP percent) {
+  const int x_size = Rf_length(codes);
+
+  SEXP out = PROTECT(Rf_allocVector(REALSXP, x_size));
+  double* p_out = REAL(out);
+
+  for (int i = 0; i < x_size; ++i) {
+    p_out[i] = NA_REAL;
+  }
+
+  struct rank_data data = {
+    .tree = new_fenwick(r_scalar_int_get(n_codes)),
+    .n = 0,
+    .p_codes = INTEGER_RO(codes),
+    .loc = loc,
+    .ties = (enum rank_ties) r_scalar_int_get(ties),
+    .percent = r_scalar_lgl_get(percent),
+    .p_out = p_out
+  };
+
+  const struct aggregate_ops ops = {
+    .reset = NULL,
+    .add = rank_add,
+    .remove = rank_remove,
+    .finalize = rank_finalize
+  };
+
+  aggregate_walk(INTEGER_RO(starts), INTEGER_RO(stops), Rf_xlength(starts), true, &ops, &data);
+
+  UNPROTECT(1);
+  return out;
+}
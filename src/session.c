@@ -0,0 +1,96 @@
+#include "slider.h"
+#include "utils.h"
+#include "compare.h"
+
+// -----------------------------------------------------------------------------
+// Session windows
+//
+// A session is a run of elements of the ascending index `i` where no two
+// consecutive elements are more than a gap apart. `ends` is `i + gap`, and a
+// new session starts at element `j` whenever `i[j] > ends[j - 1]`, which is
+// found in a single pass with the typed comparators of the window engine, so
+// dates, date-times, and the data frame proxies of POSIXlt are all handled
+// the same way. Sessions are numbered from `0`, like the periods of
+// `warp::warp_distance()`, so they can be used anywhere a period can.
+
+static R_xlen_t session_distance(SEXP i, SEXP ends, R_xlen_t size, double* p_out) {
+  if (size == 0) {
+    return 0;
+  }
+
+  const window_compare_fn compare = get_window_compare_fn(i);
+  const void* p_i = get_window_compare_data(i);
+  const void* p_ends = get_window_compare_data(ends);
+
+  double session = 0;
+  p_out[0] = session;
+
+  for (R_xlen_t j = 1; j < size; ++j) {
+    if (j % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    if (compare(p_i, j, p_ends, j - 1) > 0) {
+      ++session;
+    }
+
+    p_out[j] = session;
+  }
+
+  return (R_xlen_t) session + 1;
+}
+
+// `i` and `ends` are the comparison proxies of the index and of `i + gap`,
+// cast to a common type. Returns the 0-based session of every element of
+// `i`, as a double vector.
+
+// [[ register() ]]
+SEXP slider_session_distance(SEXP i, SEXP ends, SEXP size) {
+  const R_xlen_t size_ = r_scalar_int_get(size);
+
+  SEXP out = PROTECT(Rf_allocVector(REALSXP, size_));
+  session_distance(i, ends, size_, REAL(out));
+
+  UNPROTECT(1);
+  return out;
+}
+
+// Like `slider_session_distance()`, but returns the 1-based `start` and
+// `stop` location of every session, as doubles, like
+// `warp::warp_boundary()`.
+
+// [[ register() ]]
+SEXP slider_session_boundary(SEXP i, SEXP ends, SEXP size) {
+  const R_xlen_t size_ = r_scalar_int_get(size);
+
+  double* p_sessions = (double*) R_alloc(size_, sizeof(double));
+  const R_xlen_t n_sessions = session_distance(i, ends, size_, p_sessions);
+
+  SEXP starts = PROTECT(Rf_allocVector(REALSXP, n_sessions));
+  SEXP stops = PROTECT(Rf_allocVector(REALSXP, n_sessions));
+
+  double* p_starts = REAL(starts);
+  double* p_stops = REAL(stops);
+
+  for (R_xlen_t j = 0; j < size_; ++j) {
+    const R_xlen_t session = (R_xlen_t) p_sessions[j];
+
+    if (j == 0 || p_sessions[j - 1] != p_sessions[j]) {
+      p_starts[session] = j + 1;
+    }
+
+    p_stops[session] = j + 1;
+  }
+
+  SEXP out = PROTECT(Rf_allocVector(VECSXP, 2));
+  SET_VECTOR_ELT(out, 0, starts);
+  SET_VECTOR_ELT(out, 1, stops);
+
+  SEXP names = PROTECT(Rf_allocVector(STRSXP, 2));
+  SET_STRING_ELT(names, 0, Rf_mkChar("start"));
+  SET_STRING_ELT(names, 1, Rf_mkChar("stop"));
+  Rf_setAttrib(out, R_NamesSymbol, names);
+
+  UNPROTECT(4);
+  return out;
+}
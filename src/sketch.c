@@ -0,0 +1,554 @@
+#include "slider.h"
+#include "utils.h"
+#include "aggregate.h"
+#include <float.h>
+
+// -----------------------------------------------------------------------------
+// Approximate quantiles from mergeable sketches
+//
+// Each bucket of `x`, i.e. each period of `slide_period()`, is summarised by
+// a DDSketch with relative accuracy `alpha`. Values are mapped to the
+// logarithmic bins `(gamma^(k - 1), gamma^k]` with
+// `gamma = (1 + alpha) / (1 - alpha)`, and estimated by a value of their bin
+// that is within a relative error of `alpha` of every value in it. Negative
+// values use a mirrored set of bins, and zeros, infinities, and missing
+// values are counted separately.
+//
+// The sketches of the buckets are stored sparsely, with one entry per
+// occupied bin, so they never take up more memory than the bins that the
+// values of each bucket actually fall into. Merging two sketches adds the
+// counts of their bins, which can be undone by subtracting them again, so a
+// sliding window over the buckets is maintained in a single dense sketch,
+// adding the sketches of the buckets that enter the window and subtracting
+// the ones that leave it.
+
+struct sketch_mapping {
+  double gamma;
+  double inv_log_gamma;
+  int key_min;
+  int n_keys;
+};
+
+// The counts of a sketch that aren't stored in bins
+struct sketch_counts {
+  R_xlen_t n_missing;
+  R_xlen_t n_zero;
+  R_xlen_t n_neg_inf;
+  R_xlen_t n_pos_inf;
+};
+
+// The sparse sketch of a bucket, `n_pos` entries for the positive bins
+// followed by `n_neg` entries for the negative ones, starting at `offset`
+struct sketch_bucket {
+  struct sketch_counts counts;
+  R_xlen_t offset;
+  int n_pos;
+  int n_neg;
+};
+
+// A dense sketch, with one count per bin in `[key_min, key_min + n_keys)`
+struct sketch_window {
+  struct sketch_counts counts;
+  R_xlen_t n_binned;
+  R_xlen_t* p_pos;
+  R_xlen_t* p_neg;
+};
+
+// Values this small in magnitude are counted as zeros, which also keeps
+// every key well within the range of an `int`
+#define SKETCH_MIN_INDEXABLE DBL_MIN
+
+// The most bins that a sketch can have. The R side requires an accuracy of
+// at least `1e-4`, which needs about 7.1 million bins to span every finite
+// double, so this is only reached by callers that skip that check.
+#define SKETCH_MAX_KEYS (1 << 23)
+
+// The key of `x` as a double, before it is known to fit in an `int`
+static inline double sketch_key_dbl(const struct sketch_mapping* p_mapping, double x) {
+  return ceil(log(x) * p_mapping->inv_log_gamma);
+}
+
+static inline int sketch_key(const struct sketch_mapping* p_mapping, double x) {
+  return (int) sketch_key_dbl(p_mapping, x);
+}
+
+static inline double sketch_value(const struct sketch_mapping* p_mapping, int key) {
+  return 2 * pow(p_mapping->gamma, key) / (1 + p_mapping->gamma);
+}
+
+// Classify `x`, returning `true` if it falls in a bin, in which case
+// `*p_negative` tells which set of bins
+static inline bool sketch_classify(double x, struct sketch_counts* p_counts, bool* p_negative) {
+  if (isnan(x)) {
+    ++p_counts->n_missing;
+    return false;
+  }
+  if (x == R_PosInf) {
+    ++p_counts->n_pos_inf;
+    return false;
+  }
+  if (x == R_NegInf) {
+    ++p_counts->n_neg_inf;
+    return false;
+  }
+  if (fabs(x) < SKETCH_MIN_INDEXABLE) {
+    ++p_counts->n_zero;
+    return false;
+  }
+
+  *p_negative = x < 0;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+
+static struct sketch_mapping new_sketch_mapping(const double* p_x, R_xlen_t size, double alpha) {
+  struct sketch_mapping mapping;
+
+  mapping.gamma = (1 + alpha) / (1 - alpha);
+  mapping.inv_log_gamma = 1 / log(mapping.gamma);
+
+  // Keys are monotonic in the magnitude of `x`, so the range of keys only
+  // depends on the smallest and largest magnitudes
+  double abs_min = R_PosInf;
+  double abs_max = 0;
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    const double abs = fabs(p_x[i]);
+
+    if (isnan(abs) || abs == R_PosInf || abs < SKETCH_MIN_INDEXABLE) {
+      continue;
+    }
+    if (abs < abs_min) {
+      abs_min = abs;
+    }
+    if (abs > abs_max) {
+      abs_max = abs;
+    }
+  }
+
+  if (abs_max == 0) {
+    mapping.key_min = 0;
+    mapping.n_keys = 0;
+    return mapping;
+  }
+
+  // Checked in double precision, so a tiny `alpha` can't overflow the keys
+  // or the dense bins of the window
+  const double key_min = sketch_key_dbl(&mapping, abs_min);
+  const double n_keys = sketch_key_dbl(&mapping, abs_max) - key_min + 1;
+
+  if (!(n_keys <= SKETCH_MAX_KEYS)) {
+    Rf_errorcall(
+      R_NilValue,
+      "The range of `.x` needs more than %i bins at an `.accuracy` of %g. Use a larger `.accuracy`.",
+      SKETCH_MAX_KEYS,
+      alpha
+    );
+  }
+
+  mapping.key_min = (int) key_min;
+  mapping.n_keys = (int) n_keys;
+
+  return mapping;
+}
+
+// Build the sparse sketch of every bucket. `p_scratch_pos` and
+// `p_scratch_neg` are dense zeroed bins, used to gather the counts of one
+// bucket at a time, and are left zeroed. When `p_keys` is `NULL`, only the
+// number of entries is computed.
+static R_xlen_t sketch_buckets_fill(const struct sketch_mapping* p_mapping,
+                                    const double* p_x,
+                                    const int* p_sizes,
+                                    int n_buckets,
+                                    R_xlen_t* p_scratch_pos,
+                                    R_xlen_t* p_scratch_neg,
+                                    int* p_touched,
+                                    struct sketch_bucket* p_buckets,
+                                    int* p_keys,
+                                    R_xlen_t* p_counts) {
+  R_xlen_t loc = 0;
+  R_xlen_t offset = 0;
+
+  for (int b = 0; b < n_buckets; ++b) {
+    if (b % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    struct sketch_bucket* p_bucket = p_buckets + b;
+    struct sketch_counts counts = { 0, 0, 0, 0 };
+
+    int n_pos = 0;
+    int n_neg = 0;
+
+    // Positive touched bins grow from the front of `p_touched`, and negative
+    // ones from the back, so a bucket never needs more than `n_keys` of each
+    const R_xlen_t end = loc + p_sizes[b];
+
+    for (; loc < end; ++loc) {
+      const double elt = p_x[loc];
+      bool negative;
+
+      if (!sketch_classify(elt, &counts, &negative)) {
+        continue;
+      }
+
+      const int idx = sketch_key(p_mapping, fabs(elt)) - p_mapping->key_min;
+
+      if (negative) {
+        if (p_scratch_neg[idx]++ == 0) {
+          p_touched[2 * p_mapping->n_keys - 1 - n_neg++] = idx;
+        }
+      } else {
+        if (p_scratch_pos[idx]++ == 0) {
+          p_touched[n_pos++] = idx;
+        }
+      }
+    }
+
+    p_bucket->counts = counts;
+    p_bucket->offset = offset;
+    p_bucket->n_pos = n_pos;
+    p_bucket->n_neg = n_neg;
+
+    for (int j = 0; j < n_pos; ++j) {
+      const int idx = p_touched[j];
+
+      if (p_keys != NULL) {
+        p_keys[offset + j] = idx;
+        p_counts[offset + j] = p_scratch_pos[idx];
+      }
+
+      p_scratch_pos[idx] = 0;
+    }
+
+    offset += n_pos;
+
+    for (int j = 0; j < n_neg; ++j) {
+      const int idx = p_touched[2 * p_mapping->n_keys - 1 - j];
+
+      if (p_keys != NULL) {
+        p_keys[offset + j] = idx;
+        p_counts[offset + j] = p_scratch_neg[idx];
+      }
+
+      p_scratch_neg[idx] = 0;
+    }
+
+    offset += n_neg;
+  }
+
+  return offset;
+}
+
+// -----------------------------------------------------------------------------
+
+// Add (`sign = 1`) or subtract (`sign = -1`) the sketch of a bucket
+static void sketch_window_update(struct sketch_window* p_window,
+                                 const struct sketch_bucket* p_bucket,
+                                 const int* p_keys,
+                                 const R_xlen_t* p_counts,
+                                 int sign) {
+  p_window->counts.n_missing += sign * p_bucket->counts.n_missing;
+  p_window->counts.n_zero += sign * p_bucket->counts.n_zero;
+  p_window->counts.n_neg_inf += sign * p_bucket->counts.n_neg_inf;
+  p_window->counts.n_pos_inf += sign * p_bucket->counts.n_pos_inf;
+
+  const int* p_bucket_keys = p_keys + p_bucket->offset;
+  const R_xlen_t* p_bucket_counts = p_counts + p_bucket->offset;
+
+  for (int j = 0; j < p_bucket->n_pos; ++j) {
+    p_window->p_pos[p_bucket_keys[j]] += sign * p_bucket_counts[j];
+    p_window->n_binned += sign * p_bucket_counts[j];
+  }
+
+  p_bucket_keys += p_bucket->n_pos;
+  p_bucket_counts += p_bucket->n_pos;
+
+  for (int j = 0; j < p_bucket->n_neg; ++j) {
+    p_window->p_neg[p_bucket_keys[j]] += sign * p_bucket_counts[j];
+    p_window->n_binned += sign * p_bucket_counts[j];
+  }
+}
+
+// The 1-based rank of the `p` quantile of `n` values, following the inverse
+// of the empirical distribution function, like `quantile(type = 1)`
+static inline R_xlen_t sketch_rank(double p, R_xlen_t n) {
+  const double fuzz = 4 * DBL_EPSILON;
+  const double np = n * p;
+  const double j = floor(np + fuzz);
+  const R_xlen_t rank = (R_xlen_t) ((np > j + fuzz) ? j + 1 : j);
+  return rank < 1 ? 1 : rank;
+}
+
+// Estimate the quantiles of the window for the `probs` in ascending order of
+// `p_order`, in a single scan over the bins from the smallest to the largest
+// value. `p_out` is the row of the output for this window, with a stride of
+// `n_rows` between the probabilities.
+static void sketch_window_quantiles(const struct sketch_window* p_window,
+                                    const struct sketch_mapping* p_mapping,
+                                    const double* p_probs,
+                                    const int* p_order,
+                                    int n_probs,
+                                    bool na_rm,
+                                    double* p_out,
+                                    R_xlen_t n_rows) {
+  const struct sketch_counts counts = p_window->counts;
+
+  const R_xlen_t n =
+    counts.n_neg_inf +
+    p_window->n_binned +
+    counts.n_zero +
+    counts.n_pos_inf;
+
+  if ((counts.n_missing != 0 && !na_rm) || n == 0) {
+    for (int j = 0; j < n_probs; ++j) {
+      p_out[j * n_rows] = NA_REAL;
+    }
+    return;
+  }
+
+  int j = 0;
+  R_xlen_t seen = 0;
+
+#define SKETCH_EMIT(COUNT, VALUE) do {                                 \
+  seen += (COUNT);                                                     \
+  while (j < n_probs && sketch_rank(p_probs[p_order[j]], n) <= seen) { \
+    p_out[p_order[j] * n_rows] = (VALUE);                              \
+    ++j;                                                               \
+  }                                                                    \
+  if (j == n_probs) {                                                  \
+    return;                                                            \
+  }                                                                    \
+} while (0)
+
+  SKETCH_EMIT(counts.n_neg_inf, R_NegInf);
+
+  for (int k = p_mapping->n_keys - 1; k >= 0; --k) {
+    if (p_window->p_neg[k] != 0) {
+      SKETCH_EMIT(p_window->p_neg[k], -sketch_value(p_mapping, p_mapping->key_min + k));
+    }
+  }
+
+  SKETCH_EMIT(counts.n_zero, 0);
+
+  for (int k = 0; k < p_mapping->n_keys; ++k) {
+    if (p_window->p_pos[k] != 0) {
+      SKETCH_EMIT(p_window->p_pos[k], sketch_value(p_mapping, p_mapping->key_min + k));
+    }
+  }
+
+  SKETCH_EMIT(counts.n_pos_inf, R_PosInf);
+
+#undef SKETCH_EMIT
+
+  never_reached("sketch_window_quantiles");
+}
+
+// -----------------------------------------------------------------------------
+
+// The bucket that the 0-based location `loc` of `x` falls in, given the
+// 0-based `p_offsets` of the start of every bucket
+static inline int bucket_locate(const R_xlen_t* p_offsets, int n_buckets, R_xlen_t loc) {
+  int lo = 0;
+  int hi = n_buckets - 1;
+
+  while (lo < hi) {
+    const int mid = lo + (hi - lo + 1) / 2;
+
+    if (p_offsets[mid] <= loc) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  return lo;
+}
+
+// The window walk of `aggregate_walk()` over the buckets, which holds the
+// sketch of the buckets of the window in `window`
+struct sketch_data {
+  struct sketch_window window;
+  const struct sketch_mapping* p_mapping;
+  const struct sketch_bucket* p_buckets;
+  const int* p_keys;
+  const R_xlen_t* p_counts;
+  const double* p_probs;
+  const int* p_order;
+  int n_probs;
+  bool na_rm;
+  const int* p_loc;
+  double* p_out;
+  R_xlen_t n_rows;
+};
+
+static void sketch_add(void* data, R_xlen_t from, R_xlen_t to) {
+  struct sketch_data* p_data = (struct sketch_data*) data;
+
+  for (R_xlen_t b = from; b < to; ++b) {
+    sketch_window_update(&p_data->window, p_data->p_buckets + b, p_data->p_keys, p_data->p_counts, 1);
+  }
+}
+
+static void sketch_remove(void* data, R_xlen_t from, R_xlen_t to) {
+  struct sketch_data* p_data = (struct sketch_data*) data;
+
+  for (R_xlen_t b = from; b < to; ++b) {
+    sketch_window_update(&p_data->window, p_data->p_buckets + b, p_data->p_keys, p_data->p_counts, -1);
+  }
+}
+
+static void sketch_finalize(void* data, R_xlen_t i, R_xlen_t lo, R_xlen_t hi) {
+  struct sketch_data* p_data = (struct sketch_data*) data;
+
+  sketch_window_quantiles(
+    &p_data->window,
+    p_data->p_mapping,
+    p_data->p_probs,
+    p_data->p_order,
+    p_data->n_probs,
+    p_data->na_rm,
+    p_data->p_out + (p_data->p_loc[i] - 1),
+    p_data->n_rows
+  );
+}
+
+// `x` is made up of contiguous buckets, with `sizes` holding the number of
+// elements of each of them. `starts` and `stops` are 1-based windows into
+// `x`, which always start and stop at bucket boundaries, with empty windows
+// having `start > stop`. The quantiles of window `i` at `probs` are written
+// to row `loc[i]` of a double matrix with `size` rows and one column per
+// probability, where rows without a window are `NA`.
+
+// [[ register() ]]
+SEXP slider_sketch_quantile(SEXP x,
+                            SEXP sizes,
+                            SEXP starts,
+                            SEXP stops,
+                            SEXP loc,
+                            SEXP size,
+                            SEXP probs,
+                            SEXP accuracy,
+                            SEXP na_rm) {
+  const R_xlen_t x_size = Rf_xlength(x);
+  const int n_buckets = Rf_length(sizes);
+  const R_xlen_t n_windows = Rf_xlength(starts);
+  const R_xlen_t size_ = r_scalar_int_get(size);
+  const int n_probs = Rf_length(probs);
+
+  const double* p_x = REAL_RO(x);
+  const int* p_sizes = INTEGER_RO(sizes);
+  const int* p_starts = INTEGER_RO(starts);
+  const int* p_stops = INTEGER_RO(stops);
+  const int* p_loc = INTEGER_RO(loc);
+  const double* p_probs = REAL_RO(probs);
+  const double accuracy_ = REAL_RO(accuracy)[0];
+  const bool na_rm_ = r_scalar_lgl_get(na_rm);
+
+  SEXP out = PROTECT(Rf_allocMatrix(REALSXP, size_, n_probs));
+  double* p_out = REAL(out);
+
+  const R_xlen_t out_size = size_ * n_probs;
+  for (R_xlen_t i = 0; i < out_size; ++i) {
+    p_out[i] = NA_REAL;
+  }
+
+  if (n_buckets == 0) {
+    UNPROTECT(1);
+    return out;
+  }
+
+  // Visit the probabilities in ascending order, so every window is answered
+  // in a single scan over its bins
+  int* p_order = (int*) R_alloc(n_probs, sizeof(int));
+
+  for (int j = 0; j < n_probs; ++j) {
+    int k = j;
+
+    for (; k > 0 && p_probs[p_order[k - 1]] > p_probs[j]; --k) {
+      p_order[k] = p_order[k - 1];
+    }
+
+    p_order[k] = j;
+  }
+
+  const struct sketch_mapping mapping = new_sketch_mapping(p_x, x_size, accuracy_);
+  const int n_keys = mapping.n_keys;
+
+  struct sketch_data data;
+
+  struct sketch_window* p_window = &data.window;
+  p_window->counts = (struct sketch_counts) { 0, 0, 0, 0 };
+  p_window->n_binned = 0;
+  p_window->p_pos = (R_xlen_t*) R_alloc(n_keys, sizeof(R_xlen_t));
+  p_window->p_neg = (R_xlen_t*) R_alloc(n_keys, sizeof(R_xlen_t));
+
+  memset(p_window->p_pos, 0, n_keys * sizeof(R_xlen_t));
+  memset(p_window->p_neg, 0, n_keys * sizeof(R_xlen_t));
+
+  struct sketch_bucket* p_buckets = (struct sketch_bucket*) R_alloc(n_buckets, sizeof(struct sketch_bucket));
+  int* p_touched = (int*) R_alloc(2 * (R_xlen_t) n_keys, sizeof(int));
+
+  // The dense bins of the window double as scratch space while the sparse
+  // sketches of the buckets are built, since they start out empty
+  const R_xlen_t n_entries = sketch_buckets_fill(
+    &mapping, p_x, p_sizes, n_buckets,
+    p_window->p_pos, p_window->p_neg, p_touched,
+    p_buckets, NULL, NULL
+  );
+
+  int* p_keys = (int*) R_alloc(n_entries, sizeof(int));
+  R_xlen_t* p_counts = (R_xlen_t*) R_alloc(n_entries, sizeof(R_xlen_t));
+
+  sketch_buckets_fill(
+    &mapping, p_x, p_sizes, n_buckets,
+    p_window->p_pos, p_window->p_neg, p_touched,
+    p_buckets, p_keys, p_counts
+  );
+
+  R_xlen_t* p_offsets = (R_xlen_t*) R_alloc(n_buckets, sizeof(R_xlen_t));
+  p_offsets[0] = 0;
+  for (int b = 1; b < n_buckets; ++b) {
+    p_offsets[b] = p_offsets[b - 1] + p_sizes[b - 1];
+  }
+
+  // The 1-based windows over the buckets, rather than the elements of `x`
+  int* p_bucket_starts = (int*) R_alloc(n_windows, sizeof(int));
+  int* p_bucket_stops = (int*) R_alloc(n_windows, sizeof(int));
+
+  for (R_xlen_t i = 0; i < n_windows; ++i) {
+    if (p_starts[i] > p_stops[i]) {
+      p_bucket_starts[i] = 1;
+      p_bucket_stops[i] = 0;
+      continue;
+    }
+
+    p_bucket_starts[i] = bucket_locate(p_offsets, n_buckets, p_starts[i] - 1) + 1;
+    p_bucket_stops[i] = bucket_locate(p_offsets, n_buckets, p_stops[i] - 1) + 1;
+  }
+
+  data.p_mapping = &mapping;
+  data.p_buckets = p_buckets;
+  data.p_keys = p_keys;
+  data.p_counts = p_counts;
+  data.p_probs = p_probs;
+  data.p_order = p_order;
+  data.n_probs = n_probs;
+  data.na_rm = na_rm_;
+  data.p_loc = p_loc;
+  data.p_out = p_out;
+  data.n_rows = size_;
+
+  const struct aggregate_ops ops = {
+    .reset = NULL,
+    .add = sketch_add,
+    .remove = sketch_remove,
+    .finalize = sketch_finalize
+  };
+
+  aggregate_walk(p_bucket_starts, p_bucket_stops, n_windows, true, &ops, &data);
+
+  UNPROTECT(1);
+  return out;
+}
@@ -1,10 +1,8 @@
 #include "slider.h"
-#include "compare.h"
+#include "window.h"
 
 // -----------------------------------------------------------------------------
 
-static SEXP compute_from(SEXP starts, double first, R_xlen_t n, bool before_unbounded);
-
 // [[ export() ]]
 SEXP slider_compute_from(SEXP starts, SEXP first, SEXP n, SEXP before_unbounded) {
   double first_ = REAL(first)[0];
@@ -20,33 +18,13 @@ SEXP slider_compute_from(SEXP starts, SEXP first, SEXP n, SEXP before_unbounded)
 
   bool before_unbounded_ = LOGICAL(before_unbounded)[0];
 
-  return compute_from(starts, first_, n_, before_unbounded_);
-}
-
-static SEXP compute_from(SEXP starts, double first, R_xlen_t n, bool before_unbounded) {
-  double* p_starts = REAL(starts);
-
-  R_xlen_t from = 1;
-
-  if (before_unbounded) {
-    return(Rf_ScalarReal(from));
-  }
-
-  for (R_xlen_t i = 0; i < n; ++i) {
-    if (first > p_starts[i]) {
-      ++from;
-    } else {
-      break;
-    }
-  }
+  R_xlen_t from = window_compute_from(REAL_RO(starts), first_, n_, before_unbounded_);
 
   return Rf_ScalarReal(from);
 }
 
 // -----------------------------------------------------------------------------
 
-static SEXP compute_to(SEXP stops, double last, R_xlen_t n, bool after_unbounded);
-
 // [[ export() ]]
 SEXP slider_compute_to(SEXP stops, SEXP last, SEXP n, SEXP after_unbounded) {
   double last_ = REAL(last)[0];
@@ -62,25 +40,7 @@ SEXP slider_compute_to(SEXP stops, SEXP last, SEXP n, SEXP after_unbounded) {
 
   bool after_unbounded_ = LOGICAL(after_unbounded)[0];
 
-  return compute_to(stops, last_, n_, after_unbounded_);
-}
-
-static SEXP compute_to(SEXP stops, double last, R_xlen_t n, bool after_unbounded) {
-  double* p_stops = REAL(stops);
-
-  R_xlen_t to = n;
-
-  if (after_unbounded) {
-    return(Rf_ScalarReal(to));
-  }
-
-  for (R_xlen_t i = n - 1; i >= 0; --i) {
-    if (last < p_stops[i]) {
-      --to;
-    } else {
-      break;
-    }
-  }
+  R_xlen_t to = window_compute_to(REAL_RO(stops), last_, n_, after_unbounded_);
 
   return Rf_ScalarReal(to);
 }
@@ -0,0 +1,384 @@
+#include "slider.h"
+#include "utils.h"
+#include "summary.h"
+#include "aggregate.h"
+
+// -----------------------------------------------------------------------------
+// Fused summaries of sliding windows
+//
+// Every requested statistic is computed from a single walk over the windows.
+// Consecutive windows of a slide overlap, so rather than summarising each
+// window from scratch, the elements that enter and leave the window are
+// added to and evicted from one shared state, which all of the statistics
+// are then read from:
+//
+// - `count`, `sum`, and `mean` are running counts and sums. Infinities are
+//   counted rather than summed, so they can be evicted again.
+// - `sd` is computed from running sums of the deviations from a shift, which
+//   is the first finite value added since the state was last empty. This
+//   avoids most of the cancellation of the naive sum of squares.
+// - `min` and `max` are the fronts of monotonic queues of locations.
+// - `first` and `last` are the boundaries of the window, or the fronts and
+//   backs of a queue of the non-missing locations when `na_rm = true`.
+// - A queue of the missing locations tells whether the window contains a
+//   missing value, and which one propagates when `na_rm = false`.
+//
+// Locations only ever enter the queues in increasing order, and the queues
+// are emptied when the walk restarts, so every queue fits in `x_size`
+// elements without wrapping around.
+
+struct queue {
+  int* p_data;
+  R_xlen_t head;
+  R_xlen_t tail;
+};
+
+static inline bool queue_is_empty(const struct queue* p_queue) {
+  return p_queue->head == p_queue->tail;
+}
+
+static inline int queue_front(const struct queue* p_queue) {
+  return p_queue->p_data[p_queue->head];
+}
+
+static inline int queue_back(const struct queue* p_queue) {
+  return p_queue->p_data[p_queue->tail - 1];
+}
+
+struct summarise_state {
+  const double* p_x;
+  bool na_rm;
+  bool extremes;
+
+  R_xlen_t n;
+  R_xlen_t n_valid;
+  R_xlen_t n_pos_inf;
+  R_xlen_t n_neg_inf;
+
+  long double sum;
+
+  bool has_shift;
+  double shift;
+  long double shifted_sum;
+  long double shifted_sum2;
+
+  struct queue valid;
+  struct queue na;
+  struct queue min;
+  struct queue max;
+};
+
+static struct queue new_queue(int size) {
+  struct queue queue;
+  queue.p_data = (int*) R_alloc(size, sizeof(int));
+  queue.head = 0;
+  queue.tail = 0;
+  return queue;
+}
+
+static void summarise_state_reset(struct summarise_state* p_state) {
+  p_state->n = 0;
+  p_state->n_valid = 0;
+  p_state->n_pos_inf = 0;
+  p_state->n_neg_inf = 0;
+  p_state->sum = 0;
+  p_state->has_shift = false;
+  p_state->shift = 0;
+  p_state->shifted_sum = 0;
+  p_state->shifted_sum2 = 0;
+
+  p_state->valid.head = p_state->valid.tail = 0;
+  p_state->na.head = p_state->na.tail = 0;
+  p_state->min.head = p_state->min.tail = 0;
+  p_state->max.head = p_state->max.tail = 0;
+}
+
+static void summarise_state_add(struct summarise_state* p_state, int loc) {
+  const double* p_x = p_state->p_x;
+  const double elt = p_x[loc];
+
+  ++p_state->n;
+
+  if (isnan(elt)) {
+    p_state->na.p_data[p_state->na.tail++] = loc;
+    return;
+  }
+
+  ++p_state->n_valid;
+  p_state->valid.p_data[p_state->valid.tail++] = loc;
+
+  if (elt == R_PosInf) {
+    ++p_state->n_pos_inf;
+  } else if (elt == R_NegInf) {
+    ++p_state->n_neg_inf;
+  } else {
+    if (!p_state->has_shift) {
+      p_state->has_shift = true;
+      p_state->shift = elt;
+    }
+
+    const long double deviation = (long double) elt - p_state->shift;
+
+    p_state->sum += elt;
+    p_state->shifted_sum += deviation;
+    p_state->shifted_sum2 += deviation * deviation;
+  }
+
+  if (!p_state->extremes) {
+    return;
+  }
+
+  struct queue* p_min = &p_state->min;
+  while (!queue_is_empty(p_min) && p_x[queue_back(p_min)] >= elt) {
+    --p_min->tail;
+  }
+  p_min->p_data[p_min->tail++] = loc;
+
+  struct queue* p_max = &p_state->max;
+  while (!queue_is_empty(p_max) && p_x[queue_back(p_max)] <= elt) {
+    --p_max->tail;
+  }
+  p_max->p_data[p_max->tail++] = loc;
+}
+
+// Evictions happen in the same order as additions, so an evicted location is
+// always at the front of any queue that still holds it
+static void summarise_state_remove(struct summarise_state* p_state, int loc) {
+  const double elt = p_state->p_x[loc];
+
+  --p_state->n;
+
+  if (isnan(elt)) {
+    ++p_state->na.head;
+    return;
+  }
+
+  --p_state->n_valid;
+  ++p_state->valid.head;
+
+  if (elt == R_PosInf) {
+    --p_state->n_pos_inf;
+  } else if (elt == R_NegInf) {
+    --p_state->n_neg_inf;
+  } else if (p_state->n_valid - p_state->n_pos_inf - p_state->n_neg_inf == 0) {
+    // No finite values are left, so start over from an exact state rather
+    // than carrying rounding error forward
+    p_state->sum = 0;
+    p_state->has_shift = false;
+    p_state->shifted_sum = 0;
+    p_state->shifted_sum2 = 0;
+  } else {
+    const long double deviation = (long double) elt - p_state->shift;
+
+    p_state->sum -= elt;
+    p_state->shifted_sum -= deviation;
+    p_state->shifted_sum2 -= deviation * deviation;
+  }
+
+  if (!p_state->extremes) {
+    return;
+  }
+
+  if (!queue_is_empty(&p_state->min) && queue_front(&p_state->min) == loc) {
+    ++p_state->min.head;
+  }
+  if (!queue_is_empty(&p_state->max) && queue_front(&p_state->max) == loc) {
+    ++p_state->max.head;
+  }
+}
+
+// Read the summary of the window `[lo, hi)` from the state. Follows the
+// conventions of `summary_range()`, with `sd` on top.
+static void summarise_state_summary(const struct summarise_state* p_state,
+                                    R_xlen_t lo,
+                                    R_xlen_t hi,
+                                    struct summary* p_summary) {
+  const double* p_x = p_state->p_x;
+
+  if (p_state->na_rm) {
+    const bool empty = queue_is_empty(&p_state->valid);
+    p_summary->first = empty ? NA_REAL : p_x[queue_front(&p_state->valid)];
+    p_summary->last = empty ? NA_REAL : p_x[queue_back(&p_state->valid)];
+    p_summary->count = p_state->n_valid;
+  } else {
+    p_summary->first = (hi > lo) ? p_x[lo] : NA_REAL;
+    p_summary->last = (hi > lo) ? p_x[hi - 1] : NA_REAL;
+    p_summary->count = p_state->n;
+  }
+
+  if (!p_state->na_rm && !queue_is_empty(&p_state->na)) {
+    // The first missing value propagates
+    const double na = p_x[queue_front(&p_state->na)];
+    p_summary->min = na;
+    p_summary->max = na;
+    p_summary->sum = na;
+    p_summary->m2 = na;
+    return;
+  }
+
+  if (p_state->extremes && !queue_is_empty(&p_state->min)) {
+    p_summary->min = p_x[queue_front(&p_state->min)];
+    p_summary->max = p_x[queue_front(&p_state->max)];
+  } else {
+    p_summary->min = R_PosInf;
+    p_summary->max = R_NegInf;
+  }
+
+  const R_xlen_t n_pos_inf = p_state->n_pos_inf;
+  const R_xlen_t n_neg_inf = p_state->n_neg_inf;
+
+  if (n_pos_inf > 0 && n_neg_inf > 0) {
+    p_summary->sum = R_NaN;
+  } else if (n_pos_inf > 0) {
+    p_summary->sum = R_PosInf;
+  } else if (n_neg_inf > 0) {
+    p_summary->sum = R_NegInf;
+  } else {
+    p_summary->sum = p_state->sum;
+  }
+
+  const R_xlen_t n_finite = p_state->n_valid - n_pos_inf - n_neg_inf;
+
+  if (n_pos_inf > 0 || n_neg_inf > 0) {
+    p_summary->m2 = R_NaN;
+  } else if (n_finite == 0) {
+    p_summary->m2 = 0;
+  } else {
+    const long double shifted_sum = p_state->shifted_sum;
+    const long double m2 = p_state->shifted_sum2 - shifted_sum * shifted_sum / n_finite;
+    p_summary->m2 = (m2 < 0) ? 0 : m2;
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+static inline void summary_cols_assign_loc(struct summary_cols cols,
+                                           SEXP loc,
+                                           R_xlen_t i,
+                                           const struct summary* p_summary) {
+  R_xlen_t n_locs;
+  const int* p_locs = aggregate_loc(loc, i, &n_locs);
+
+  for (R_xlen_t j = 0; j < n_locs; ++j) {
+    summary_cols_assign(cols, p_locs[j] - 1, p_summary);
+  }
+}
+
+static void summary_cols_init(struct summary_cols cols, R_xlen_t size) {
+  for (int j = 0; j < cols.n_stats; ++j) {
+    if (cols.p_stats[j] == SUMMARY_STAT_COUNT) {
+      int* p_col = (int*) cols.p_cols[j];
+      for (R_xlen_t i = 0; i < size; ++i) {
+        p_col[i] = NA_INTEGER;
+      }
+    } else {
+      double* p_col = (double*) cols.p_cols[j];
+      for (R_xlen_t i = 0; i < size; ++i) {
+        p_col[i] = NA_REAL;
+      }
+    }
+  }
+}
+
+// The window walk of `aggregate_walk()`
+struct summarise_data {
+  struct summarise_state state;
+  struct summary_cols cols;
+  SEXP loc;
+};
+
+static void summarise_reset(void* data) {
+  struct summarise_data* p_data = (struct summarise_data*) data;
+  summarise_state_reset(&p_data->state);
+}
+
+static void summarise_add(void* data, R_xlen_t from, R_xlen_t to) {
+  struct summarise_data* p_data = (struct summarise_data*) data;
+
+  for (R_xlen_t i = from; i < to; ++i) {
+    summarise_state_add(&p_data->state, i);
+  }
+}
+
+static void summarise_remove(void* data, R_xlen_t from, R_xlen_t to) {
+  struct summarise_data* p_data = (struct summarise_data*) data;
+
+  for (R_xlen_t i = from; i < to; ++i) {
+    summarise_state_remove(&p_data->state, i);
+  }
+}
+
+static void summarise_finalize(void* data, R_xlen_t i, R_xlen_t lo, R_xlen_t hi) {
+  struct summarise_data* p_data = (struct summarise_data*) data;
+
+  struct summary summary;
+  summarise_state_summary(&p_data->state, lo, hi, &summary);
+  summary_cols_assign_loc(p_data->cols, p_data->loc, i, &summary);
+}
+
+static bool summary_stats_any_extremes(SEXP stats) {
+  const int* p_stats = INTEGER_RO(stats);
+  const int n_stats = Rf_length(stats);
+
+  for (int j = 0; j < n_stats; ++j) {
+    if (p_stats[j] == SUMMARY_STAT_MIN || p_stats[j] == SUMMARY_STAT_MAX) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Summarise the 1-based `[starts, stops]` windows of `x`, where empty windows
+// have `start > stop`. The summary of window `i` is written to the 1-based
+// output locations `loc[i]`, which is either an integer vector with one
+// location per window, or a list of integer vectors when a window is shared
+// by several locations, as with `slide_index()`. Locations without a window
+// are `NA`. Returns the list of output columns.
+//
+// Windows are expected to move forward, as they do for every slide, in which
+// case each element of `x` is added and evicted at most once. If a window
+// moves backwards, the walk restarts from that window.
+
+// [[ register() ]]
+SEXP slider_slide_summarise(SEXP x,
+                            SEXP starts,
+                            SEXP stops,
+                            SEXP loc,
+                            SEXP size,
+                            SEXP stats,
+                            SEXP na_rm) {
+  int n_prot = 0;
+
+  const int x_size = Rf_length(x);
+  const R_xlen_t size_ = r_scalar_int_get(size);
+
+  struct summarise_data data;
+  data.loc = loc;
+
+  struct summarise_state* p_state = &data.state;
+  p_state->p_x = REAL_RO(x);
+  p_state->na_rm = r_scalar_lgl_get(na_rm);
+  p_state->extremes = summary_stats_any_extremes(stats);
+  p_state->valid = new_queue(x_size);
+  p_state->na = new_queue(x_size);
+  p_state->min = new_queue(p_state->extremes ? x_size : 0);
+  p_state->max = new_queue(p_state->extremes ? x_size : 0);
+
+  data.cols = new_summary_cols(stats, size_);
+  PROTECT_SUMMARY_COLS(&data.cols, &n_prot);
+
+  summary_cols_init(data.cols, size_);
+
+  const struct aggregate_ops ops = {
+    .reset = summarise_reset,
+    .add = summarise_add,
+    .remove = summarise_remove,
+    .finalize = summarise_finalize
+  };
+
+  aggregate_walk(INTEGER_RO(starts), INTEGER_RO(stops), Rf_xlength(starts), true, &ops, &data);
+
+  UNPROTECT(n_prot);
+  return data.cols.data;
+}
@@ -3,6 +3,7 @@
 #include "utils.h"
 #include "params.h"
 #include "assign.h"
+#include "slide.h"
 
 // -----------------------------------------------------------------------------
 
@@ -15,6 +16,11 @@
       R_CheckUserInterrupt();                                                  \
     }                                                                          \
                                                                                \
+    /* Skipped locations keep their initialised value */                       \
+    if (p_where != NULL && !p_where[i]) {                                      \
+      continue;                                                                \
+    }                                                                          \
+                                                                               \
     int window_start = max(start, 0);                                          \
     int window_stop = min(stop, size - 1);                                     \
     int window_size = window_stop - window_start + 1;                          \
@@ -66,67 +72,30 @@ SEXP slide_common_impl(SEXP x,
                        SEXP f_call,
                        SEXP ptype,
                        SEXP env,
-                       SEXP params) {
+                       SEXP params,
+                       SEXP where) {
 
   const int type = pull_type(params);
   const int force = compute_force(type);
   const int size = compute_size(x, type);
 
-  bool before_unbounded = false;
-  bool after_unbounded = false;
-
   const bool constrain = pull_constrain(params);
   const bool atomic = pull_atomic(params);
-  const int before = pull_before(params, &before_unbounded);
-  const int after = pull_after(params, &after_unbounded);
-  const int step = pull_step(params);
-  const bool complete = pull_complete(params);
 
-  const bool before_positive = before >= 0;
-  const bool after_positive = after >= 0;
+  struct slide_info info = new_slide_info(params, size);
 
-  check_double_negativeness(before, after, before_positive, after_positive);
-  check_before_negativeness(before, after, before_positive, after_unbounded);
-  check_after_negativeness(after, before, after_positive, before_unbounded);
+  const int iteration_min = info.iteration_min;
+  const int iteration_max = info.iteration_max;
+  const int step = info.step;
+  const int start_step = info.start_step;
+  const int stop_step = info.stop_step;
 
-  int iteration_min = 0;
-  int iteration_max = size;
+  int start = info.start;
+  int stop = info.stop;
 
-  // Iteration adjustment
-  if (complete) {
-    if (before_positive) {
-      iteration_min += before;
-    }
-    if (after_positive) {
-      iteration_max -= after;
-    }
-  }
-
-  // Forward adjustment to match the number of iterations
-  int offset = 0;
-  if (complete && before_positive) {
-    offset = before;
-  }
-
-  int start;
-  int start_step;
-  if (before_unbounded) {
-    start = 0;
-    start_step = 0;
-  } else {
-    start = offset - before;
-    start_step = step;
-  }
-
-  int stop;
-  int stop_step;
-  if (after_unbounded) {
-    stop = size - 1;
-    stop_step = 0;
-  } else {
-    stop = offset + after;
-    stop_step = step;
-  }
+  // Either `NULL`, or a logical vector the size of `x`. The windows still
+  // advance at every location, but `.f` is only called where it is `TRUE`.
+  const int* p_where = (where == R_NilValue) ? NULL : LOGICAL_RO(where);
 
   // The indices to slice x with
   SEXP window = PROTECT(compact_seq(0, 0, true));
@@ -156,6 +125,193 @@ SEXP slide_common_impl(SEXP x,
 
 // -----------------------------------------------------------------------------
 
+// Compute the positional windows that `slide_common_impl()` would evaluate,
+// without evaluating anything. Returns a list of:
+// - `loc`: The 1-based output locations that would be evaluated.
+// - `start` / `stop`: The 1-based window boundaries for each of those
+//   locations, restricted to the range of `x`. Windows that lie entirely
+//   outside of `x` are empty, with `start = 1` and `stop = 0`.
+
+// [[ register() ]]
+SEXP slide_windows_impl(SEXP size, SEXP params) {
+  const int size_ = r_scalar_int_get(size);
+
+  struct slide_info info = new_slide_info(params, size_);
+
+  const int n = slide_info_n_iterations(info);
+
+  SEXP loc = PROTECT(Rf_allocVector(INTSXP, n));
+  SEXP starts = PROTECT(Rf_allocVector(INTSXP, n));
+  SEXP stops = PROTECT(Rf_allocVector(INTSXP, n));
+
+  slide_info_fill_windows(info, size_, INTEGER(loc), INTEGER(starts), INTEGER(stops));
+
+  SEXP out = PROTECT(Rf_allocVector(VECSXP, 3));
+  SET_VECTOR_ELT(out, 0, loc);
+  SET_VECTOR_ELT(out, 1, starts);
+  SET_VECTOR_ELT(out, 2, stops);
+
+  SEXP names = PROTECT(Rf_allocVector(STRSXP, 3));
+  SET_STRING_ELT(names, 0, Rf_mkChar("loc"));
+  SET_STRING_ELT(names, 1, Rf_mkChar("start"));
+  SET_STRING_ELT(names, 2, Rf_mkChar("stop"));
+  Rf_setAttrib(out, R_NamesSymbol, names);
+
+  UNPROTECT(5);
+  return out;
+}
+
+// Like `slide_windows_impl()`, but for groups of `sizes` elements stored back
+// to back in `x`. The windows of each group are computed as if the group was
+// the whole of `x`, and are then shifted to the group's location, so windows
+// never cross group boundaries. On top of `loc`, `start`, and `stop`, returns
+// `breaks`, the 0-based offsets of the windows of each group in the output,
+// with one extra element holding the total number of windows. The params are
+// only parsed once, however many groups there are.
+
+// [[ register() ]]
+SEXP slide_grouped_windows_impl(SEXP sizes, SEXP params) {
+  const int n_groups = Rf_length(sizes);
+  const int* p_sizes = INTEGER_RO(sizes);
+
+  SEXP breaks = PROTECT(Rf_allocVector(INTSXP, n_groups + 1));
+  int* p_breaks = INTEGER(breaks);
+
+  // The params are pulled and validated once, up front
+  bool before_unbounded = false;
+  bool after_unbounded = false;
+
+  const int before = pull_before(params, &before_unbounded);
+  const int after = pull_after(params, &after_unbounded);
+  const int step = pull_step(params);
+  const bool complete = pull_complete(params);
+
+  // The status doesn't depend on the size, so this also validates the params
+  // when there are no groups
+  struct slide_info info;
+
+  enum window_status status = slide_info_compute(
+    &info,
+    0,
+    before,
+    before_unbounded,
+    after,
+    after_unbounded,
+    step,
+    complete
+  );
+
+  if (status != WINDOW_OK) {
+    stop_window_status(status, before, after, step);
+  }
+
+  struct slide_info* p_infos = (struct slide_info*) R_alloc(n_groups, sizeof(struct slide_info));
+
+  int n = 0;
+
+  for (int g = 0; g < n_groups; ++g) {
+    slide_info_compute(
+      p_infos + g,
+      p_sizes[g],
+      before,
+      before_unbounded,
+      after,
+      after_unbounded,
+      step,
+      complete
+    );
+
+    p_breaks[g] = n;
+    n += slide_info_n_iterations(p_infos[g]);
+  }
+
+  p_breaks[n_groups] = n;
+
+  SEXP loc = PROTECT(Rf_allocVector(INTSXP, n));
+  SEXP starts = PROTECT(Rf_allocVector(INTSXP, n));
+  SEXP stops = PROTECT(Rf_allocVector(INTSXP, n));
+
+  int* p_loc = INTEGER(loc);
+  int* p_starts = INTEGER(starts);
+  int* p_stops = INTEGER(stops);
+
+  int offset = 0;
+
+  for (int g = 0; g < n_groups; ++g) {
+    if (g % 1024 == 0) {
+      R_CheckUserInterrupt();
+    }
+
+    const int size = p_sizes[g];
+    const int from = p_breaks[g];
+    const int to = p_breaks[g + 1];
+
+    slide_info_fill_windows(p_infos[g], size, p_loc + from, p_starts + from, p_stops + from);
+
+    // Empty windows keep `start = 1` and `stop = 0`
+    for (int j = from; j < to; ++j) {
+      p_loc[j] += offset;
+
+      if (p_starts[j] <= p_stops[j]) {
+        p_starts[j] += offset;
+        p_stops[j] += offset;
+      }
+    }
+
+    offset += size;
+  }
+
+  SEXP out = PROTECT(Rf_allocVector(VECSXP, 4));
+  SET_VECTOR_ELT(out, 0, loc);
+  SET_VECTOR_ELT(out, 1, starts);
+  SET_VECTOR_ELT(out, 2, stops);
+  SET_VECTOR_ELT(out, 3, breaks);
+
+  SEXP names = PROTECT(Rf_allocVector(STRSXP, 4));
+  SET_STRING_ELT(names, 0, Rf_mkChar("loc"));
+  SET_STRING_ELT(names, 1, Rf_mkChar("start"));
+  SET_STRING_ELT(names, 2, Rf_mkChar("stop"));
+  SET_STRING_ELT(names, 3, Rf_mkChar("breaks"));
+  Rf_setAttrib(out, R_NamesSymbol, names);
+
+  UNPROTECT(6);
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
+// [[ include("slide.h") ]]
+struct slide_info new_slide_info(SEXP params, int size) {
+  bool before_unbounded = false;
+  bool after_unbounded = false;
+
+  const int before = pull_before(params, &before_unbounded);
+  const int after = pull_after(params, &after_unbounded);
+  const int step = pull_step(params);
+  const bool complete = pull_complete(params);
+
+  struct slide_info info;
+
+  enum window_status status = slide_info_compute(
+    &info,
+    size,
+    before,
+    before_unbounded,
+    after,
+    after_unbounded,
+    step,
+    complete
+  );
+
+  if (status != WINDOW_OK) {
+    stop_window_status(status, before, after, step);
+  }
+
+  return info;
+}
+
+// -----------------------------------------------------------------------------
+
 #undef SLIDE_LOOP
 #undef SLIDE_LOOP_ATOMIC
 #undef SLIDE_LOOP_BARRIER
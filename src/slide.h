@@ -0,0 +1,14 @@
+#ifndef SLIDER_SLIDE_H
+#define SLIDER_SLIDE_H
+
+#include "slider.h"
+#include "window.h"
+
+// -----------------------------------------------------------------------------
+
+// Pull the `.before`, `.after`, `.step`, and `.complete` params out of
+// `params` and compute the iteration state of a positional slide over `size`
+// elements. See `slide_info_compute()` for the pure C version.
+struct slide_info new_slide_info(SEXP params, int size);
+
+#endif
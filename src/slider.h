@@ -23,4 +23,11 @@
   #define STRING_PTR_RO(x) ((const SEXP*) STRING_PTR(x))
 #endif
 
+// ALTREP lists are only available in R >= 4.3.0
+#if (R_VERSION >= R_Version(4, 3, 0))
+  #define SLIDER_HAS_ALTLIST 1
+#else
+  #define SLIDER_HAS_ALTLIST 0
+#endif
+
 #endif
@@ -0,0 +1,432 @@
+#include "slider.h"
+#include "utils.h"
+#include "summary.h"
+
+// -----------------------------------------------------------------------------
+
+// [[ include("summary.h") ]]
+struct summary_cols new_summary_cols(SEXP stats, R_xlen_t size) {
+  struct summary_cols cols;
+
+  cols.n_stats = Rf_length(stats);
+  cols.p_stats = INTEGER_RO(stats);
+
+  cols.data = PROTECT(Rf_allocVector(VECSXP, cols.n_stats));
+  cols.p_cols = (void**) R_alloc(cols.n_stats, sizeof(void*));
+
+  for (int j = 0; j < cols.n_stats; ++j) {
+    SEXP col;
+
+    if (cols.p_stats[j] == SUMMARY_STAT_COUNT) {
+      col = Rf_allocVector(INTSXP, size);
+      SET_VECTOR_ELT(cols.data, j, col);
+      cols.p_cols[j] = INTEGER(col);
+    } else {
+      col = Rf_allocVector(REALSXP, size);
+      SET_VECTOR_ELT(cols.data, j, col);
+      cols.p_cols[j] = REAL(col);
+    }
+  }
+
+  UNPROTECT(1);
+  return cols;
+}
+
+// -----------------------------------------------------------------------------
+
+// Summarise `p_x[start:stop]` in a single pass.
+//
+// With `na_rm = false`, missing values propagate through the `min`, `max`,
+// `sum`, and `mean`, and are counted by `count`, like their base R
+// equivalents. `first` and `last` are the elements at the boundaries of the
+// window, missing or not.
+//
+// With `na_rm = true`, missing values are skipped entirely.
+//
+// An empty window results in `NA` for `first` and `last`, `Inf` and `-Inf`
+// for `min` and `max`, `0` for `sum` and `count`, and `NaN` for `mean`.
+//
+// This doesn't touch the R API, so it is safe to call from multiple threads.
+
+// [[ include("summary.h") ]]
+void summary_range(const double* p_x,
+                   R_xlen_t start,
+                   R_xlen_t stop,
+                   bool na_rm,
+                   struct summary* p_summary) {
+  double first = NA_REAL;
+  double last = NA_REAL;
+  double min = R_PosInf;
+  double max = R_NegInf;
+  long double sum = 0;
+  R_xlen_t count = 0;
+
+  bool any_na = false;
+
+  for (R_xlen_t j = start; j <= stop; ++j) {
+    const double elt = p_x[j];
+
+    if (isnan(elt)) {
+      if (na_rm) {
+        continue;
+      }
+
+      // The first missing value sticks as the `min` and `max`
+      if (!any_na) {
+        any_na = true;
+        min = elt;
+        max = elt;
+      }
+    } else if (!any_na) {
+      if (elt < min) {
+        min = elt;
+      }
+      if (elt > max) {
+        max = elt;
+      }
+    }
+
+    if (count == 0) {
+      first = elt;
+    }
+
+    last = elt;
+    sum += elt;
+    ++count;
+  }
+
+  p_summary->first = first;
+  p_summary->last = last;
+  p_summary->min = min;
+  p_summary->max = max;
+  p_summary->sum = sum;
+  p_summary->count = count;
+}
+
+// -----------------------------------------------------------------------------
+
+static void summary_cache_init_sums(struct summary_cache* p_cache);
+static void summary_cache_init_locations(struct summary_cache* p_cache);
+static void summary_cache_init_tables(struct summary_cache* p_cache, int max_width);
+
+// [[ include("summary.h") ]]
+struct summary_cache new_summary_cache(const double* p_x,
+                                       int size,
+                                       SEXP stats,
+                                       bool na_rm,
+                                       int max_width) {
+  struct summary_cache cache;
+
+  cache.p_x = p_x;
+  cache.size = size;
+  cache.na_rm = na_rm;
+
+  cache.p_sum = NULL;
+  cache.p_count = NULL;
+  cache.p_pos_inf = NULL;
+  cache.p_neg_inf = NULL;
+  cache.p_next_na = NULL;
+  cache.p_next_valid = NULL;
+  cache.p_prev_valid = NULL;
+  cache.n_levels = 0;
+  cache.p_log2 = NULL;
+  cache.p_min = NULL;
+  cache.p_max = NULL;
+
+  bool need_sums = false;
+  bool need_locations = false;
+  bool need_tables = false;
+
+  const int n_stats = Rf_length(stats);
+  const int* p_stats = INTEGER_RO(stats);
+
+  for (int j = 0; j < n_stats; ++j) {
+    switch (p_stats[j]) {
+    case SUMMARY_STAT_FIRST:
+    case SUMMARY_STAT_LAST: {
+      need_locations = need_locations || na_rm;
+      break;
+    }
+    case SUMMARY_STAT_MIN:
+    case SUMMARY_STAT_MAX: {
+      need_tables = true;
+      need_locations = need_locations || !na_rm;
+      break;
+    }
+    case SUMMARY_STAT_SUM:
+    case SUMMARY_STAT_MEAN: {
+      need_sums = true;
+      need_locations = need_locations || !na_rm;
+      break;
+    }
+    case SUMMARY_STAT_COUNT: {
+      need_sums = need_sums || na_rm;
+      break;
+    }
+    }
+  }
+
+  if (need_sums) {
+    summary_cache_init_sums(&cache);
+  }
+  if (need_locations) {
+    summary_cache_init_locations(&cache);
+  }
+  if (need_tables) {
+    summary_cache_init_tables(&cache, max_width);
+  }
+
+  return cache;
+}
+
+static void summary_cache_init_sums(struct summary_cache* p_cache) {
+  const double* p_x = p_cache->p_x;
+  const int size = p_cache->size;
+
+  long double* p_sum = (long double*) R_alloc(size + 1, sizeof(long double));
+  int* p_count = (int*) R_alloc(size + 1, sizeof(int));
+  int* p_pos_inf = (int*) R_alloc(size + 1, sizeof(int));
+  int* p_neg_inf = (int*) R_alloc(size + 1, sizeof(int));
+
+  p_sum[0] = 0;
+  p_count[0] = 0;
+  p_pos_inf[0] = 0;
+  p_neg_inf[0] = 0;
+
+  for (int i = 0; i < size; ++i) {
+    const double elt = p_x[i];
+
+    p_sum[i + 1] = p_sum[i];
+    p_count[i + 1] = p_count[i];
+    p_pos_inf[i + 1] = p_pos_inf[i];
+    p_neg_inf[i + 1] = p_neg_inf[i];
+
+    if (isnan(elt)) {
+      continue;
+    }
+
+    ++p_count[i + 1];
+
+    // Infinities are counted rather than summed, otherwise any window
+    // differenced against a prefix containing an infinity would be `NaN`
+    if (elt == R_PosInf) {
+      ++p_pos_inf[i + 1];
+    } else if (elt == R_NegInf) {
+      ++p_neg_inf[i + 1];
+    } else {
+      p_sum[i + 1] += elt;
+    }
+  }
+
+  p_cache->p_sum = p_sum;
+  p_cache->p_count = p_count;
+  p_cache->p_pos_inf = p_pos_inf;
+  p_cache->p_neg_inf = p_neg_inf;
+}
+
+static void summary_cache_init_locations(struct summary_cache* p_cache) {
+  const double* p_x = p_cache->p_x;
+  const int size = p_cache->size;
+
+  int* p_missing = (int*) R_alloc(size, sizeof(int));
+  int* p_next_na = (int*) R_alloc(size, sizeof(int));
+  int* p_next_valid = (int*) R_alloc(size, sizeof(int));
+  int* p_prev_valid = (int*) R_alloc(size, sizeof(int));
+
+  int next_na = size;
+
+  for (int i = size - 1; i >= 0; --i) {
+    p_missing[i] = isnan(p_x[i]);
+
+    if (p_missing[i]) {
+      next_na = i;
+    }
+
+    p_next_na[i] = next_na;
+  }
+
+  compute_valid_locations(p_missing, size, p_next_valid, p_prev_valid);
+
+  p_cache->p_next_na = p_next_na;
+  p_cache->p_next_valid = p_next_valid;
+  p_cache->p_prev_valid = p_prev_valid;
+}
+
+static void summary_cache_init_tables(struct summary_cache* p_cache, int max_width) {
+  const double* p_x = p_cache->p_x;
+  const int size = p_cache->size;
+
+  if (max_width < 1) {
+    max_width = 1;
+  }
+
+  // `p_log2[width]` is `floor(log2(width))`
+  int* p_log2 = (int*) R_alloc(max_width + 1, sizeof(int));
+  p_log2[0] = 0;
+  p_log2[1] = 0;
+
+  for (int width = 2; width <= max_width; ++width) {
+    p_log2[width] = p_log2[width / 2] + 1;
+  }
+
+  const int n_levels = p_log2[max_width] + 1;
+
+  double* p_min = (double*) R_alloc((size_t) n_levels * size, sizeof(double));
+  double* p_max = (double*) R_alloc((size_t) n_levels * size, sizeof(double));
+
+  // Missing values are handled separately with `p_next_na`, so here they
+  // are replaced with values that never win a comparison
+  for (int i = 0; i < size; ++i) {
+    const double elt = p_x[i];
+    const bool missing = isnan(elt);
+    p_min[i] = missing ? R_PosInf : elt;
+    p_max[i] = missing ? R_NegInf : elt;
+  }
+
+  for (int k = 1; k < n_levels; ++k) {
+    const int half = 1 << (k - 1);
+    const int n = size - (1 << k) + 1;
+
+    const double* p_min_prev = p_min + (size_t) (k - 1) * size;
+    const double* p_max_prev = p_max + (size_t) (k - 1) * size;
+    double* p_min_cur = p_min + (size_t) k * size;
+    double* p_max_cur = p_max + (size_t) k * size;
+
+    for (int i = 0; i < n; ++i) {
+      const double lhs_min = p_min_prev[i];
+      const double rhs_min = p_min_prev[i + half];
+      p_min_cur[i] = lhs_min < rhs_min ? lhs_min : rhs_min;
+
+      const double lhs_max = p_max_prev[i];
+      const double rhs_max = p_max_prev[i + half];
+      p_max_cur[i] = lhs_max > rhs_max ? lhs_max : rhs_max;
+    }
+  }
+
+  p_cache->n_levels = n_levels;
+  p_cache->p_log2 = p_log2;
+  p_cache->p_min = p_min;
+  p_cache->p_max = p_max;
+}
+
+// -----------------------------------------------------------------------------
+
+// Answer the `[start, stop]` window of `x` from the cache. Only the fields of
+// `p_summary` that correspond to statistics the cache was built for are
+// meaningful. The results match `summary_range()`, except that when missing
+// values are not removed, `sum` and `mean` propagate the first missing value
+// of the window rather than the result of the arithmetic on them.
+
+// [[ include("summary.h") ]]
+void summary_cache_query(const struct summary_cache* p_cache,
+                         int start,
+                         int stop,
+                         struct summary* p_summary) {
+  const double* p_x = p_cache->p_x;
+  const bool na_rm = p_cache->na_rm;
+
+  p_summary->first = NA_REAL;
+  p_summary->last = NA_REAL;
+  p_summary->min = R_PosInf;
+  p_summary->max = R_NegInf;
+  p_summary->sum = 0;
+  p_summary->count = 0;
+
+  if (stop < start) {
+    return;
+  }
+
+  if (na_rm) {
+    if (p_cache->p_next_valid != NULL) {
+      const int first = p_cache->p_next_valid[start];
+      const int last = p_cache->p_prev_valid[stop];
+
+      if (first <= stop) {
+        p_summary->first = p_x[first];
+        p_summary->last = p_x[last];
+      }
+    }
+  } else {
+    p_summary->first = p_x[start];
+    p_summary->last = p_x[stop];
+  }
+
+  if (p_cache->p_count != NULL) {
+    p_summary->count = p_cache->p_count[stop + 1] - p_cache->p_count[start];
+  }
+  if (!na_rm) {
+    p_summary->count = stop - start + 1;
+  }
+
+  // Missing values propagate through everything else
+  if (!na_rm && p_cache->p_next_na != NULL) {
+    const int next_na = p_cache->p_next_na[start];
+
+    if (next_na <= stop) {
+      const double na = p_x[next_na];
+      p_summary->min = na;
+      p_summary->max = na;
+      p_summary->sum = na;
+      return;
+    }
+  }
+
+  if (p_cache->p_sum != NULL) {
+    const int n_pos_inf = p_cache->p_pos_inf[stop + 1] - p_cache->p_pos_inf[start];
+    const int n_neg_inf = p_cache->p_neg_inf[stop + 1] - p_cache->p_neg_inf[start];
+
+    if (n_pos_inf > 0 && n_neg_inf > 0) {
+      p_summary->sum = R_NaN;
+    } else if (n_pos_inf > 0) {
+      p_summary->sum = R_PosInf;
+    } else if (n_neg_inf > 0) {
+      p_summary->sum = R_NegInf;
+    } else {
+      p_summary->sum = p_cache->p_sum[stop + 1] - p_cache->p_sum[start];
+    }
+  }
+
+  if (p_cache->p_min != NULL) {
+    const int size = p_cache->size;
+    const int k = p_cache->p_log2[stop - start + 1];
+    const int other = stop - (1 << k) + 1;
+
+    const double* p_min = p_cache->p_min + (size_t) k * size;
+    const double* p_max = p_cache->p_max + (size_t) k * size;
+
+    p_summary->min = p_min[start] < p_min[other] ? p_min[start] : p_min[other];
+    p_summary->max = p_max[start] > p_max[other] ? p_max[start] : p_max[other];
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+// [[ include("summary.h") ]]
+void summary_cols_assign(struct summary_cols cols,
+                         R_xlen_t i,
+                         const struct summary* p_summary) {
+  for (int j = 0; j < cols.n_stats; ++j) {
+    void* p_col = cols.p_cols[j];
+
+    switch (cols.p_stats[j]) {
+    case SUMMARY_STAT_FIRST: ((double*) p_col)[i] = p_summary->first; break;
+    case SUMMARY_STAT_LAST: ((double*) p_col)[i] = p_summary->last; break;
+    case SUMMARY_STAT_MIN: ((double*) p_col)[i] = p_summary->min; break;
+    case SUMMARY_STAT_MAX: ((double*) p_col)[i] = p_summary->max; break;
+    case SUMMARY_STAT_SUM: ((double*) p_col)[i] = (double) p_summary->sum; break;
+    case SUMMARY_STAT_COUNT: ((int*) p_col)[i] = (int) p_summary->count; break;
+    case SUMMARY_STAT_MEAN: {
+      ((double*) p_col)[i] = (p_summary->count == 0) ?
+        R_NaN :
+        (double) (p_summary->sum / p_summary->count);
+      break;
+    }
+    case SUMMARY_STAT_SD: {
+      ((double*) p_col)[i] = (p_summary->count < 2) ?
+        NA_REAL :
+        sqrt((double) (p_summary->m2 / (p_summary->count - 1)));
+      break;
+    }
+    }
+  }
+}
@@ -0,0 +1,116 @@
+#ifndef SLIDER_SUMMARY_H
+#define SLIDER_SUMMARY_H
+
+#include "slider.h"
+
+// -----------------------------------------------------------------------------
+// Native summary statistics
+//
+// The order of these must match `summary_stats` in `R/summary.R`, as the R
+// side passes the statistics through as 0-based integer codes.
+
+enum summary_stat {
+  SUMMARY_STAT_FIRST = 0,
+  SUMMARY_STAT_LAST = 1,
+  SUMMARY_STAT_MIN = 2,
+  SUMMARY_STAT_MAX = 3,
+  SUMMARY_STAT_SUM = 4,
+  SUMMARY_STAT_COUNT = 5,
+  SUMMARY_STAT_MEAN = 6,
+  SUMMARY_STAT_SD = 7
+};
+
+// -----------------------------------------------------------------------------
+
+// The result of summarising a single window of `x`. Everything is computed
+// in one pass, regardless of which statistics were requested, as the
+// bookkeeping is cheaper than branching on the requested statistics
+// for every element.
+struct summary {
+  double first;
+  double last;
+  double min;
+  double max;
+  long double sum;
+  R_xlen_t count;
+  // The sum of squared deviations from the mean, for `sd`. Only tracked by
+  // the windowed walk of `slider_slide_summarise()`.
+  long double m2;
+};
+
+// Output columns for a set of requested statistics. `p_cols` holds the
+// data pointers of the columns so they can be written to without touching
+// the R API, i.e. from multiple threads.
+struct summary_cols {
+  SEXP data;
+  int n_stats;
+  const int* p_stats;
+  void** p_cols;
+};
+
+// Precomputed caches that answer any `[start, stop]` window of `x` in O(1),
+// independent of the width of the window and of how much windows overlap.
+//
+// - Prefix sums of the finite values and prefix counts of the non-missing
+//   values and infinities answer `sum`, `mean`, and `count`.
+// - Sparse tables answer `min` and `max`. Level `k` holds the min / max of
+//   the `2^k` elements starting at each location. Only the levels required
+//   by the widest window are built, so the tables cost O(n log(w)).
+// - The next missing, next non-missing, and previous non-missing locations
+//   answer whether a window contains a missing value, and `first` and `last`
+//   when missing values are removed.
+//
+// Only the caches required by the requested statistics are built.
+struct summary_cache {
+  const double* p_x;
+  int size;
+  bool na_rm;
+
+  long double* p_sum;
+  int* p_count;
+  int* p_pos_inf;
+  int* p_neg_inf;
+
+  int* p_next_na;
+  int* p_next_valid;
+  int* p_prev_valid;
+
+  int n_levels;
+  int* p_log2;
+  double* p_min;
+  double* p_max;
+};
+
+#define PROTECT_SUMMARY_COLS(cols, n) do {  \
+  PROTECT((cols)->data);                    \
+  *n += 1;                                  \
+} while (0)
+
+// -----------------------------------------------------------------------------
+
+struct summary_cols new_summary_cols(SEXP stats, R_xlen_t size);
+
+void summary_range(const double* p_x,
+                   R_xlen_t start,
+                   R_xlen_t stop,
+                   bool na_rm,
+                   struct summary* p_summary);
+
+struct summary_cache new_summary_cache(const double* p_x,
+                                       int size,
+                                       SEXP stats,
+                                       bool na_rm,
+                                       int max_width);
+
+void summary_cache_query(const struct summary_cache* p_cache,
+                         int start,
+                         int stop,
+                         struct summary* p_summary);
+
+void summary_cols_assign(struct summary_cols cols,
+                         R_xlen_t i,
+                         const struct summary* p_summary);
+
+int kernel_summary_stat(SEXP pointer, bool combiner);
+
+#endif
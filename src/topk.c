@@ -0,0 +1,151 @@
+#include "slider.h"
+#include "utils.h"
+#include "aggregate.h"
+#include "fenwick.h"
+
+// -----------------------------------------------------------------------------
+// Rolling top-k
+//
+// Every non-missing element of `x` is given a unique code on the R side, in
+// the order that elements should be reported in, so code `1` is the
+// largest element for a top-k, or the smallest for a bottom-k, with ties
+// broken by position. A Fenwick tree over the codes holds the elements of
+// the current window, which are added and evicted as the window slides, and
+// the `k` best elements of a window are found with `k` order statistic
+// queries, each in O(log(n)), without ever sorting the window.
+
+// Write the positions of the `k` best elements of the window to row `row` of
+// the output, padded with `NA` when the window holds fewer than `k` elements
+static inline void topk_assign(const struct fenwick* p_tree,
+                               const int* p_positions,
+                               int n,
+                               int k,
+                               R_xlen_t row,
+                               R_xlen_t n_rows,
+                               const double* p_x,
+                               double* p_out_value,
+                               int* p_out_position) {
+  const int n_found = min(n, k);
+
+  for (int j = 0; j < n_found; ++j) {
+    const int position = p_positions[fenwick_find(p_tree, j + 1) - 1];
+    p_out_position[j * n_rows + row] = position;
+    p_out_value[j * n_rows + row] = p_x[position - 1];
+  }
+
+  for (int j = n_found; j < k; ++j) {
+    p_out_position[j * n_rows + row] = NA_INTEGER;
+    p_out_value[j * n_rows + row] = NA_REAL;
+  }
+}
+
+// The window walk of `aggregate_walk()`, which holds the elements of the
+// window in `tree`, `n` of them
+struct topk_data {
+  struct fenwick tree;
+  int n;
+  int k;
+  const int* p_codes;
+  const int* p_positions;
+  const double* p_x;
+  R_xlen_t x_size;
+  SEXP loc;
+  double* p_out_value;
+  int* p_out_position;
+};
+
+static void topk_add(void* data, R_xlen_t from, R_xlen_t to) {
+  struct topk_data* p_data = (struct topk_data*) data;
+  fenwick_update_range(&p_data->tree, p_data->p_codes, from, to, 1, &p_data->n);
+}
+
+static void topk_remove(void* data, R_xlen_t from, R_xlen_t to) {
+  struct topk_data* p_data = (struct topk_data*) data;
+  fenwick_update_range(&p_data->tree, p_data->p_codes, from, to, -1, &p_data->n);
+}
+
+static void topk_finalize(void* data, R_xlen_t i, R_xlen_t lo, R_xlen_t hi) {
+  struct topk_data* p_data = (struct topk_data*) data;
+
+  R_xlen_t n_locs;
+  const int* p_locs = aggregate_loc(p_data->loc, i, &n_locs);
+
+  for (R_xlen_t j = 0; j < n_locs; ++j) {
+    topk_assign(
+      &p_data->tree,
+      p_data->p_positions,
+      p_data->n,
+      p_data->k,
+      p_locs[j] - 1,
+      p_data->x_size,
+      p_data->p_x,
+      p_data->p_out_value,
+      p_data->p_out_position
+    );
+  }
+}
+
+// `codes` are the report order of every element of `x`, with `NA` for
+// missing values, which are ignored, and `positions` maps each code back to
+// its 1-based position in `x`. `starts`, `stops`, and `loc` are as for
+// `slider_slide_summarise()`. Returns a list of a double matrix of values
+// and an integer matrix of positions, each with one row per element of `x`
+// and `k` columns, where rows without a window are `NA`.
+
+// [[ register() ]]
+SEXP slider_slide_top_k(SEXP x,
+                        SEXP codes,
+                        SEXP positions,
+                        SEXP starts,
+                        SEXP stops,
+                        SEXP loc,
+                        SEXP k) {
+  const int x_size = Rf_length(x);
+  const int k_ = r_scalar_int_get(k);
+
+  SEXP out_value = PROTECT(Rf_allocMatrix(REALSXP, x_size, k_));
+  SEXP out_position = PROTECT(Rf_allocMatrix(INTSXP, x_size, k_));
+
+  double* p_out_value = REAL(out_value);
+  int* p_out_position = INTEGER(out_position);
+
+  const R_xlen_t out_size = (R_xlen_t) x_size * k_;
+  for (R_xlen_t i = 0; i < out_size; ++i) {
+    p_out_value[i] = NA_REAL;
+    p_out_position[i] = NA_INTEGER;
+  }
+
+  struct topk_data data = {
+    .tree = new_fenwick(Rf_length(positions)),
+    .n = 0,
+    .k = k_,
+    .p_codes = INTEGER_RO(codes),
+    .p_positions = INTEGER_RO(positions),
+    .p_x = REAL_RO(x),
+    .x_size = x_size,
+    .loc = loc,
+    .p_out_value = p_out_value,
+    .p_out_position = p_out_position
+  };
+
+  const struct aggregate_ops ops = {
+    .reset = NULL,
+    .add = topk_add,
+    .remove = topk_remove,
+    .finalize = topk_finalize
+  };
+
+  aggregate_walk(INTEGER_RO(starts), INTEGER_RO(stops), Rf_xlength(starts), true, &ops, &data);
+
+  SEXP out = PROTECT(Rf_allocVector(VECSXP, 2));
+  SET_VECTOR_ELT(out, 0, out_value);
+  SET_VECTOR_ELT(out, 1, out_position);
+
+  SEXP names = PROTECT(Rf_allocVector(STRSXP, 2));
+  SET_STRING_ELT(names, 0, Rf_mkChar("value"));
+  SET_STRING_ELT(names, 1, Rf_mkChar("position"));
+  Rf_setAttrib(out, R_NamesSymbol, names);
+
+  UNPROTECT(4);
+  return out;
+}
@@ -3,6 +3,10 @@
 #include "compare.h"
 #include "slider-vctrs.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 SEXP strings_dot_before = NULL;
 SEXP strings_dot_after = NULL;
 SEXP strings_dot_step = NULL;
@@ -11,6 +15,7 @@ SEXP strings_dot_complete = NULL;
 SEXP syms_dot_x = NULL;
 SEXP syms_dot_y = NULL;
 SEXP syms_dot_l = NULL;
+SEXP syms_dot_state = NULL;
 
 SEXP slider_shared_empty_lgl = NULL;
 SEXP slider_shared_empty_int = NULL;
@@ -133,6 +138,49 @@ int compute_force(int type) {
 
 // -----------------------------------------------------------------------------
 
+// The number of threads to split `n_tasks` independent tasks over. This is
+// always 1 without OpenMP support.
+int compute_n_threads(bool parallel, R_xlen_t n_tasks) {
+#ifdef _OPENMP
+  if (parallel && n_tasks > 1) {
+    const int n_threads = omp_get_max_threads();
+    return n_tasks < n_threads ? (int) n_tasks : n_threads;
+  }
+#endif
+  return 1;
+}
+
+// -----------------------------------------------------------------------------
+
+// The 0-based location of the next and previous non-missing element at or
+// around every location of `x`, from `p_missing`, which holds whether each
+// element is missing. Locations past the end of `x` are `size`, and
+// locations before the start are `-1`.
+void compute_valid_locations(const int* p_missing,
+                             int size,
+                             int* p_next_valid,
+                             int* p_prev_valid) {
+  int next_valid = size;
+
+  for (int i = size - 1; i >= 0; --i) {
+    if (!p_missing[i]) {
+      next_valid = i;
+    }
+    p_next_valid[i] = next_valid;
+  }
+
+  int prev_valid = -1;
+
+  for (int i = 0; i < size; ++i) {
+    if (!p_missing[i]) {
+      prev_valid = i;
+    }
+    p_prev_valid[i] = prev_valid;
+  }
+}
+
+// -----------------------------------------------------------------------------
+
 SEXP slider_names(SEXP x, int type) {
   if (type == SLIDE) {
     return vec_names(x);
@@ -213,6 +261,7 @@ void slider_initialize_utils(SEXP ns) {
   syms_dot_x = Rf_install(".x");
   syms_dot_y = Rf_install(".y");
   syms_dot_l = Rf_install(".l");
+  syms_dot_state = Rf_install(".state");
 
   strings_dot_before = Rf_allocVector(STRSXP, 1);
   R_PreserveObject(strings_dot_before);
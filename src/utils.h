@@ -51,6 +51,7 @@ extern SEXP strings_dot_complete;
 extern SEXP syms_dot_x;
 extern SEXP syms_dot_y;
 extern SEXP syms_dot_l;
+extern SEXP syms_dot_state;
 
 extern SEXP slider_shared_empty_lgl;
 extern SEXP slider_shared_empty_int;
@@ -68,6 +69,8 @@ void check_hop_starts_not_past_stops(SEXP starts, SEXP stops);
 
 int compute_size(SEXP x, int type);
 int compute_force(int type);
+int compute_n_threads(bool parallel, R_xlen_t n_tasks);
+void compute_valid_locations(const int* p_missing, int size, int* p_next_valid, int* p_prev_valid);
 
 SEXP slider_names(SEXP x, int type);
 
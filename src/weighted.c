@@ -0,0 +1,309 @@
+#include "slider.h"
+#include "utils.h"
+
+// -----------------------------------------------------------------------------
+// Weighted windows
+//
+// Every window covers `before + after + 1` positions, and position `j` of the
+// window is multiplied by `weights[j]`. Positions that fall outside of `x`
+// are left out of the sum, which is how partial windows are computed.
+//
+// Narrow kernels take a direct dot product per window. Wide kernels are
+// applied with overlap-save block convolution instead: `x` is cut into
+// blocks of `n_fft` elements that overlap by `k - 1`, and each block is
+// transformed, multiplied by the transform of the weights, and transformed
+// back, which costs O(log(k)) per element rather than O(k). A block that
+// touches a non-finite value would spread it to every output of the block,
+// so those blocks fall back to the direct dot product.
+
+// Kernels with at least this many weights may be convolved with FFTs
+#define WEIGHTED_FFT_MIN_SIZE 64
+
+// The dot product of `p_weights[lo, hi)` with the elements of `x` under
+// them, for the window of `x` that starts at `offset`. Four accumulators
+// let the compiler vectorise the loop.
+static inline double weighted_dot(const double* p_x,
+                                  const double* p_weights,
+                                  R_xlen_t offset,
+                                  R_xlen_t lo,
+                                  R_xlen_t hi) {
+  const double* p_x_window = p_x + offset;
+
+  double acc0 = 0;
+  double acc1 = 0;
+  double acc2 = 0;
+  double acc3 = 0;
+
+  R_xlen_t j = lo;
+
+  for (; j + 4 <= hi; j += 4) {
+    acc0 += p_weights[j] * p_x_window[j];
+    acc1 += p_weights[j + 1] * p_x_window[j + 1];
+    acc2 += p_weights[j + 2] * p_x_window[j + 2];
+    acc3 += p_weights[j + 3] * p_x_window[j + 3];
+  }
+
+  for (; j < hi; ++j) {
+    acc0 += p_weights[j] * p_x_window[j];
+  }
+
+  return (acc0 + acc1) + (acc2 + acc3);
+}
+
+// The weighted sum of the window centered on the 0-based location `i`
+static inline double weighted_direct(const double* p_x,
+                                     R_xlen_t x_size,
+                                     const double* p_weights,
+                                     R_xlen_t k,
+                                     R_xlen_t before,
+                                     R_xlen_t i) {
+  // The window starts at `x[offset]`, and only the weights in `[lo, hi)`
+  // fall within `x`
+  const R_xlen_t offset = i - before;
+
+  R_xlen_t lo = offset < 0 ? -offset : 0;
+  R_xlen_t hi = x_size - offset < k ? x_size - offset : k;
+
+  if (hi < lo) {
+    hi = lo;
+  }
+
+  return weighted_dot(p_x, p_weights, offset, lo, hi);
+}
+
+// -----------------------------------------------------------------------------
+// FFT
+
+struct fft_plan {
+  R_xlen_t size;
+  int* p_reverse;
+  double* p_cos;
+  double* p_sin;
+};
+
+static struct fft_plan new_fft_plan(R_xlen_t size) {
+  int bits = 0;
+  while (((R_xlen_t) 1 << bits) < size) {
+    ++bits;
+  }
+
+  int* p_reverse = (int*) R_alloc(size, sizeof(int));
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    int reverse = 0;
+
+    for (int b = 0; b < bits; ++b) {
+      reverse |= ((i >> b) & 1) << (bits - 1 - b);
+    }
+
+    p_reverse[i] = reverse;
+  }
+
+  const R_xlen_t half = size / 2;
+
+  double* p_cos = (double*) R_alloc(half, sizeof(double));
+  double* p_sin = (double*) R_alloc(half, sizeof(double));
+
+  for (R_xlen_t i = 0; i < half; ++i) {
+    const double angle = -2 * M_PI * i / size;
+    p_cos[i] = cos(angle);
+    p_sin[i] = sin(angle);
+  }
+
+  return (struct fft_plan) {
+    .size = size,
+    .p_reverse = p_reverse,
+    .p_cos = p_cos,
+    .p_sin = p_sin
+  };
+}
+
+// In place, iterative radix-2 FFT. The inverse transform is not scaled.
+static void fft(const struct fft_plan* p_plan, double* p_re, double* p_im, bool inverse) {
+  const R_xlen_t size = p_plan->size;
+
+  for (R_xlen_t i = 0; i < size; ++i) {
+    const R_xlen_t j = p_plan->p_reverse[i];
+
+    if (i < j) {
+      double tmp = p_re[i];
+      p_re[i] = p_re[j];
+      p_re[j] = tmp;
+
+      tmp = p_im[i];
+      p_im[i] = p_im[j];
+      p_im[j] = tmp;
+    }
+  }
+
+  const double sign = inverse ? -1 : 1;
+
+  for (R_xlen_t len = 2; len <= size; len <<= 1) {
+    const R_xlen_t half = len / 2;
+    const R_xlen_t stride = size / len;
+
+    for (R_xlen_t i = 0; i < size; i += len) {
+      for (R_xlen_t j = 0; j < half; ++j) {
+        const double w_re = p_plan->p_cos[j * stride];
+        const double w_im = sign * p_plan->p_sin[j * stride];
+
+        const R_xlen_t a = i + j;
+        const R_xlen_t b = a + half;
+
+        const double t_re = p_re[b] * w_re - p_im[b] * w_im;
+        const double t_im = p_re[b] * w_im + p_im[b] * w_re;
+
+        p_re[b] = p_re[a] - t_re;
+        p_im[b] = p_im[a] - t_im;
+        p_re[a] += t_re;
+        p_im[a] += t_im;
+      }
+    }
+  }
+}
+
+// Fill `p_y` with the weighted sum of every window of `x`, by overlap-save
+// block convolution. `p_invalid` is the running count of non-finite values
+// of `x`, with `x_size + 1` elements.
+static void weighted_fft(const double* p_x,
+                         R_xlen_t x_size,
+                         const int* p_invalid,
+                         const double* p_weights,
+                         R_xlen_t k,
+                         R_xlen_t before,
+                         double* p_y) {
+  R_xlen_t n_fft = 1;
+  while (n_fft < 2 * k) {
+    n_fft <<= 1;
+  }
+
+  // Each block computes `n_block` outputs from `n_fft` elements of `x`
+  const R_xlen_t n_block = n_fft - k + 1;
+
+  struct fft_plan plan = new_fft_plan(n_fft);
+
+  // The transform of the reversed weights, so that the circular convolution
+  // of a block with it is the weighted sum of its windows
+  double* p_weights_re = (double*) R_alloc(n_fft, sizeof(double));
+  double* p_weights_im = (double*) R_alloc(n_fft, sizeof(double));
+
+  for (R_xlen_t j = 0; j < n_fft; ++j) {
+    p_weights_re[j] = j < k ? p_weights[k - 1 - j] : 0;
+    p_weights_im[j] = 0;
+  }
+
+  fft(&plan, p_weights_re, p_weights_im, false);
+
+  double* p_re = (double*) R_alloc(n_fft, sizeof(double));
+  double* p_im = (double*) R_alloc(n_fft, sizeof(double));
+
+  for (R_xlen_t block = 0; block < x_size; block += n_block) {
+    R_CheckUserInterrupt();
+
+    const R_xlen_t n_out = min(n_block, x_size - block);
+
+    // The block reads `x[first, first + n_fft)`, restricted to the range
+    // of `x`
+    const R_xlen_t first = block - before;
+    const R_xlen_t lo = first < 0 ? 0 : (first > x_size ? x_size : first);
+    const R_xlen_t hi = first + n_fft < 0 ? 0 : (first + n_fft > x_size ? x_size : first + n_fft);
+
+    if (p_invalid[hi] - p_invalid[lo] > 0) {
+      for (R_xlen_t i = block; i < block + n_out; ++i) {
+        p_y[i] = weighted_direct(p_x, x_size, p_weights, k, before, i);
+      }
+      continue;
+    }
+
+    for (R_xlen_t j = 0; j < n_fft; ++j) {
+      const R_xlen_t loc = first + j;
+      p_re[j] = (loc >= 0 && loc < x_size) ? p_x[loc] : 0;
+      p_im[j] = 0;
+    }
+
+    fft(&plan, p_re, p_im, false);
+
+    for (R_xlen_t j = 0; j < n_fft; ++j) {
+      const double re = p_re[j] * p_weights_re[j] - p_im[j] * p_weights_im[j];
+      const double im = p_re[j] * p_weights_im[j] + p_im[j] * p_weights_re[j];
+      p_re[j] = re;
+      p_im[j] = im;
+    }
+
+    fft(&plan, p_re, p_im, true);
+
+    // The first `k - 1` results wrapped around, and are discarded
+    for (R_xlen_t j = 0; j < n_out; ++j) {
+      p_y[block + j] = p_re[j + k - 1] / n_fft;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+// `weights` are applied to the `before + after + 1` positions of each
+// window, and `loc` holds the 1-based locations to evaluate. Returns a double
+// vector the size of `x`, where locations that aren't evaluated are `NA`.
+
+// [[ register() ]]
+SEXP slider_slide_weighted(SEXP x, SEXP weights, SEXP before, SEXP loc) {
+  const R_xlen_t x_size = Rf_xlength(x);
+  const R_xlen_t k = Rf_xlength(weights);
+  const R_xlen_t before_ = r_scalar_int_get(before);
+  const R_xlen_t n_loc = Rf_xlength(loc);
+
+  const double* p_x = REAL_RO(x);
+  const double* p_weights = REAL_RO(weights);
+  const int* p_loc = INTEGER_RO(loc);
+
+  SEXP out = PROTECT(Rf_allocVector(REALSXP, x_size));
+  double* p_out = REAL(out);
+
+  for (R_xlen_t i = 0; i < x_size; ++i) {
+    p_out[i] = NA_REAL;
+  }
+
+  // Convolving costs about `log2(n_fft)` butterflies per element of `x` for
+  // each of the two transforms, while the direct method costs `k`
+  // multiplications per evaluated location
+  R_xlen_t log_fft = 1;
+  while (((R_xlen_t) 1 << log_fft) < 2 * k) {
+    ++log_fft;
+  }
+
+  const bool use_fft =
+    k >= WEIGHTED_FFT_MIN_SIZE &&
+    (double) n_loc * k > 4.0 * x_size * log_fft;
+
+  if (!use_fft) {
+    for (R_xlen_t i = 0; i < n_loc; ++i) {
+      if (i % 1024 == 0) {
+        R_CheckUserInterrupt();
+      }
+
+      const R_xlen_t row = p_loc[i] - 1;
+      p_out[row] = weighted_direct(p_x, x_size, p_weights, k, before_, row);
+    }
+
+    UNPROTECT(1);
+    return out;
+  }
+
+  int* p_invalid = (int*) R_alloc(x_size + 1, sizeof(int));
+  p_invalid[0] = 0;
+
+  for (R_xlen_t i = 0; i < x_size; ++i) {
+    p_invalid[i + 1] = p_invalid[i] + !isfinite(p_x[i]);
+  }
+
+  double* p_y = (double*) R_alloc(x_size, sizeof(double));
+  weighted_fft(p_x, x_size, p_invalid, p_weights, k, before_, p_y);
+
+  for (R_xlen_t i = 0; i < n_loc; ++i) {
+    const R_xlen_t row = p_loc[i] - 1;
+    p_out[row] = p_y[row];
+  }
+
+  UNPROTECT(1);
+  return out;
+}
@@ -0,0 +1,220 @@
+#include "slider.h"
+#include "utils.h"
+#include "params.h"
+#include "aggregate.h"
+#include "summary.h"
+
+// -----------------------------------------------------------------------------
+// Multiple window widths
+//
+// Every width shares the same `.after`, so at each location the windows of
+// all of the widths end at the same element, and only differ in how far back
+// they start.
+//
+// The built-in `"sum"`, `"mean"`, `"min"`, and `"max"` kernels are answered
+// from a single `summary_cache` over `x`, the prefix sums and sparse tables
+// of `slide_summarise()` and `hop_summarise()`. The cache is built once, in
+// `O(n)` for the sums and `O(n log(w))` for the tables, where `w` is the
+// widest window, and every window of every width is then answered in `O(1)`.
+//
+// Registered kernels can only add and remove single elements, not merge two
+// states, so a wider window can't be built from a narrower one for less than
+// sliding it on its own. They fall back to walking each width on its own,
+// with the scratch memory shared by all of the walks, which is `O(n * W)`
+// updates for `W` widths.
+
+// The result of the built-in kernel computing `stat` on the 0-based
+// `[start, stop]` window, which matches the result of its native walk
+static inline double widths_summary_value(const struct summary_cache* p_cache,
+                                          enum summary_stat stat,
+                                          int start,
+                                          int stop) {
+  if (stop < start) {
+    switch (stat) {
+    case SUMMARY_STAT_SUM: return 0;
+    case SUMMARY_STAT_MEAN: return R_NaN;
+    default: return NA_REAL;
+    }
+  }
+
+  struct summary summary;
+  summary_cache_query(p_cache, start, stop, &summary);
+
+  switch (stat) {
+  case SUMMARY_STAT_MIN: return summary.min;
+  case SUMMARY_STAT_MAX: return summary.max;
+  default: break;
+  }
+
+  // The sum kernels count missing values rather than propagating them
+  if (p_cache->p_next_na[start] <= stop) {
+    return NA_REAL;
+  }
+
+  if (stat == SUMMARY_STAT_SUM) {
+    return (double) summary.sum;
+  } else {
+    return (double) (summary.sum / summary.count);
+  }
+}
+
+// The widest window of any of the widths, which is what the sparse tables
+// and the ring buffers of the combiners are sized by. `p_loc`, `p_starts`,
+// and `p_stops` are scratch memory for the windows of a single width.
+static int widths_max_width(const struct slide_info* p_infos,
+                            int n_widths,
+                            int size,
+                            int* p_loc,
+                            int* p_starts,
+                            int* p_stops) {
+  int max_width = 0;
+
+  for (int k = 0; k < n_widths; ++k) {
+    const int n = slide_info_fill_windows(p_infos[k], size, p_loc, p_starts, p_stops);
+
+    for (int j = 0; j < n; ++j) {
+      max_width = max(max_width, p_stops[j] - p_starts[j] + 1);
+    }
+  }
+
+  return max_width;
+}
+
+static void widths_summarise(enum summary_stat stat,
+                             const double* p_x,
+                             int size,
+                             const struct slide_info* p_infos,
+                             int n_widths,
+                             double* p_out) {
+  int* p_loc = (int*) R_alloc(size, sizeof(int));
+  int* p_starts = (int*) R_alloc(size, sizeof(int));
+  int* p_stops = (int*) R_alloc(size, sizeof(int));
+
+  const int max_width = widths_max_width(p_infos, n_widths, size, p_loc, p_starts, p_stops);
+
+  SEXP stats = PROTECT(Rf_ScalarInteger(stat));
+  const struct summary_cache cache = new_summary_cache(p_x, size, stats, false, max_width);
+
+  for (int k = 0; k < n_widths; ++k) {
+    const int n = slide_info_fill_windows(p_infos[k], size, p_loc, p_starts, p_stops);
+
+    double* p_col = p_out + (R_xlen_t) k * size;
+
+    for (int j = 0; j < n; ++j) {
+      if (j % 1024 == 0) {
+        R_CheckUserInterrupt();
+      }
+
+      p_col[p_loc[j] - 1] = widths_summary_value(&cache, stat, p_starts[j] - 1, p_stops[j] - 1);
+    }
+  }
+
+  UNPROTECT(1);
+}
+
+static void widths_walk(SEXP pointer,
+                        bool combiner,
+                        const double* p_x,
+                        int size,
+                        const struct slide_info* p_infos,
+                        int n_widths,
+                        double* p_out) {
+  int* p_loc = (int*) R_alloc(size, sizeof(int));
+  int* p_starts = (int*) R_alloc(size, sizeof(int));
+  int* p_stops = (int*) R_alloc(size, sizeof(int));
+  double* p_results = (double*) R_alloc(size, sizeof(double));
+
+  const struct slider_combiner* p_combiner = NULL;
+  const struct slider_aggregator* p_aggregator = NULL;
+  R_xlen_t width = 0;
+  void* buffer;
+
+  if (combiner) {
+    p_combiner = slider_combiner_deref(pointer);
+    width = max(widths_max_width(p_infos, n_widths, size, p_loc, p_starts, p_stops), 1);
+    buffer = R_alloc(combine_native_buffer_size(p_combiner, width), 1);
+  } else {
+    p_aggregator = slider_aggregator_deref(pointer);
+    buffer = R_alloc(1, p_aggregator->state_size);
+  }
+
+  for (int k = 0; k < n_widths; ++k) {
+    const int n = slide_info_fill_windows(p_infos[k], size, p_loc, p_starts, p_stops);
+
+    if (combiner) {
+      combine_native_walk(p_combiner, p_x, width, p_starts, p_stops, n, buffer, true, p_results);
+    } else {
+      aggregate_native_walk(p_aggregator, p_x, p_starts, p_stops, n, buffer, true, p_results);
+    }
+
+    double* p_col = p_out + (R_xlen_t) k * size;
+
+    for (int j = 0; j < n; ++j) {
+      p_col[p_loc[j] - 1] = p_results[j];
+    }
+  }
+}
+
+// `befores` holds the `.before` of each width, with `befores_unbounded`
+// marking the unbounded ones. `params` holds the `.after` and `.complete`
+// shared by every width, like the `params` of `slide_common_impl()`.
+// `pointer` is a native aggregator, or a native combiner if `combiner` is
+// `TRUE`. Returns a double matrix with one column per width, where locations
+// that aren't evaluated are `NA`.
+
+// [[ register() ]]
+SEXP slider_slide_widths(SEXP x,
+                         SEXP befores,
+                         SEXP befores_unbounded,
+                         SEXP params,
+                         SEXP pointer,
+                         SEXP combiner) {
+  const int size = Rf_length(x);
+  const int n_widths = Rf_length(befores);
+
+  const int* p_befores = INTEGER_RO(befores);
+  const int* p_befores_unbounded = LOGICAL_RO(befores_unbounded);
+
+  bool after_unbounded = false;
+  const int after = pull_after(params, &after_unbounded);
+  const bool complete = pull_complete(params);
+
+  struct slide_info* p_infos = (struct slide_info*) R_alloc(n_widths, sizeof(struct slide_info));
+
+  for (int k = 0; k < n_widths; ++k) {
+    enum window_status status = slide_info_compute(
+      p_infos + k,
+      size,
+      p_befores[k],
+      p_befores_unbounded[k],
+      after,
+      after_unbounded,
+      1,
+      complete
+    );
+
+    if (status != WINDOW_OK) {
+      stop_window_status(status, p_befores[k], after, 1);
+    }
+  }
+
+  SEXP out = PROTECT(Rf_allocMatrix(REALSXP, size, n_widths));
+  double* p_out = REAL(out);
+
+  const R_xlen_t out_size = (R_xlen_t) size * n_widths;
+  for (R_xlen_t i = 0; i < out_size; ++i) {
+    p_out[i] = NA_REAL;
+  }
+
+  const bool combiner_ = r_scalar_lgl_get(combiner);
+  const int stat = kernel_summary_stat(pointer, combiner_);
+
+  if (stat == -1) {
+    widths_walk(pointer, combiner_, REAL_RO(x), size, p_infos, n_widths, p_out);
+  } else {
+    widths_summarise((enum summary_stat) stat, REAL_RO(x), size, p_infos, n_widths, p_out);
+  }
+
+  UNPROTECT(1);
+  return out;
+}
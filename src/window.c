@@ -0,0 +1,417 @@
+#include "window.h"
+
+// This file must not include R headers, see `window.h`
+
+static inline int window_max(int x, int y) {
+  return x > y ? x : y;
+}
+
+static inline int window_min(int x, int y) {
+  return x < y ? x : y;
+}
+
+static inline int window_abs(int x) {
+  return x < 0 ? -x : x;
+}
+
+// -----------------------------------------------------------------------------
+
+// [[ include("window.h") ]]
+enum window_status slide_info_compute(struct slide_info* p_info,
+                                      int size,
+                                      int before,
+                                      bool before_unbounded,
+                                      int after,
+                                      bool after_unbounded,
+                                      int step,
+                                      bool complete) {
+  if (step < 1) {
+    return WINDOW_ERROR_STEP;
+  }
+
+  // Unbounded values are ignored
+  if (before_unbounded) {
+    before = 0;
+  }
+  if (after_unbounded) {
+    after = 0;
+  }
+
+  const bool before_positive = before >= 0;
+  const bool after_positive = after >= 0;
+
+  if (!before_positive && !after_positive) {
+    return WINDOW_ERROR_DOUBLE_NEGATIVE;
+  }
+  if (!before_positive && !after_unbounded && window_abs(before) > after) {
+    return WINDOW_ERROR_BEFORE_NEGATIVE;
+  }
+  if (!after_positive && !before_unbounded && window_abs(after) > before) {
+    return WINDOW_ERROR_AFTER_NEGATIVE;
+  }
+
+  p_info->step = step;
+  p_info->iteration_min = 0;
+  p_info->iteration_max = size;
+
+  // Iteration adjustment
+  if (complete) {
+    if (before_positive) {
+      p_info->iteration_min += before;
+    }
+    if (after_positive) {
+      p_info->iteration_max -= after;
+    }
+  }
+
+  // Forward adjustment to match the number of iterations
+  int offset = 0;
+  if (complete && before_positive) {
+    offset = before;
+  }
+
+  if (before_unbounded) {
+    p_info->start = 0;
+    p_info->start_step = 0;
+  } else {
+    p_info->start = offset - before;
+    p_info->start_step = step;
+  }
+
+  if (after_unbounded) {
+    p_info->stop = size - 1;
+    p_info->stop_step = 0;
+  } else {
+    p_info->stop = offset + after;
+    p_info->stop_step = step;
+  }
+
+  return WINDOW_OK;
+}
+
+// [[ include("window.h") ]]
+int slide_info_n_iterations(struct slide_info info) {
+  if (info.iteration_max <= info.iteration_min) {
+    return 0;
+  }
+
+  return (info.iteration_max - info.iteration_min - 1) / info.step + 1;
+}
+
+// Fill `p_loc`, `p_starts`, and `p_stops` with the 1-based output locations
+// and window boundaries of each iteration, restricted to the range of `x`.
+// Windows that lie entirely outside of `x` are empty, with `start = 1` and
+// `stop = 0`. Returns the number of iterations.
+// [[ include("window.h") ]]
+int slide_info_fill_windows(struct slide_info info,
+                            int size,
+                            int* p_loc,
+                            int* p_starts,
+                            int* p_stops) {
+  int start = info.start;
+  int stop = info.stop;
+  int j = 0;
+
+  for (int i = info.iteration_min;
+       i < info.iteration_max;
+       i += info.step, start += info.start_step, stop += info.stop_step, ++j) {
+    int window_start = window_max(start, 0);
+    int window_stop = window_min(stop, size - 1);
+
+    if (window_stop < window_start) {
+      window_start = 0;
+      window_stop = -1;
+    }
+
+    p_loc[j] = i + 1;
+    p_starts[j] = window_start + 1;
+    p_stops[j] = window_stop + 1;
+  }
+
+  return j;
+}
+
+// -----------------------------------------------------------------------------
+
+// https://stackoverflow.com/questions/10996418
+// [[ include("window.h") ]]
+int window_compare_int(const void* x, int i, const void* y, int j) {
+  const int lhs = ((const int*) x)[i];
+  const int rhs = ((const int*) y)[j];
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+// [[ include("window.h") ]]
+int window_compare_dbl(const void* x, int i, const void* y, int j) {
+  const double lhs = ((const double*) x)[i];
+  const double rhs = ((const double*) y)[j];
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+// [[ include("window.h") ]]
+struct window_index new_window_index(const void* data, int size, window_compare_fn compare) {
+  struct window_index index;
+
+  index.data = data;
+  index.size = size;
+  index.first_pos = 0;
+  index.last_pos = size - 1;
+
+  index.current_start_pos = 0;
+  index.current_stop_pos = 0;
+
+  index.compare = compare;
+
+  return index;
+}
+
+// [[ include("window.h") ]]
+struct window_range new_window_range(const void* starts, const void* stops, int size) {
+  struct window_range range;
+
+  range.starts = starts;
+  range.stops = stops;
+  range.first_pos = 0;
+  range.size = size;
+
+  range.start_unbounded = (starts == NULL);
+  range.stop_unbounded = (stops == NULL);
+
+  return range;
+}
+
+// Restrict `p_index` and `p_range` to the positions `[from, from + size)`,
+// and rewind the index. This walks the windows of independent groups that
+// are stored back to back in the same index, with every window confined to
+// its own group. All positions stay relative to the full index.
+// [[ include("window.h") ]]
+void window_restrict(struct window_index* p_index,
+                     struct window_range* p_range,
+                     int from,
+                     int size) {
+  p_index->size = size;
+  p_index->first_pos = from;
+  p_index->last_pos = from + size - 1;
+  p_index->current_start_pos = from;
+  p_index->current_stop_pos = from;
+
+  p_range->first_pos = from;
+  p_range->size = size;
+}
+
+// -----------------------------------------------------------------------------
+
+// With `complete = true`, skip the leading windows that start before the
+// first value of the index, and the trailing windows that stop after its last
+// value. The range is sorted, so these are found by walking in from the ends.
+
+// [[ include("window.h") ]]
+int window_min_iteration(struct window_index index, struct window_range range, bool complete) {
+  int out = range.first_pos;
+
+  if (!complete || range.start_unbounded) {
+    return out;
+  }
+
+  const int end = range.first_pos + range.size;
+
+  for (int j = range.first_pos; j < end; ++j) {
+    if (index.compare(index.data, index.first_pos, range.starts, j) > 0) {
+      ++out;
+    } else {
+      break;
+    }
+  }
+
+  return out;
+}
+
+// [[ include("window.h") ]]
+int window_max_iteration(struct window_index index, struct window_range range, bool complete) {
+  int out = range.first_pos + range.size;
+
+  if (!complete || range.stop_unbounded) {
+    return out;
+  }
+
+  for (int j = out - 1; j >= range.first_pos; --j) {
+    if (index.compare(index.data, index.last_pos, range.stops, j) < 0) {
+      --out;
+    } else {
+      break;
+    }
+  }
+
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+// `index` is passed by pointer so we can permanently
+// update the current start/stop position
+
+static int locate_window_starts_pos(struct window_index* p_index, struct window_range range, int pos) {
+  // Pin to the start
+  if (range.start_unbounded) {
+    return p_index->first_pos;
+  }
+
+  // Past the end? Signal OOB with `last_pos + 1`.
+  // This also handles size zero `.i` with `.starts` / `.stops` that have size.
+  // Current pos will be 0, but `last_pos` will be -1.
+  if (p_index->current_start_pos > p_index->last_pos) {
+    return p_index->last_pos + 1;
+  }
+
+  while (p_index->compare(p_index->data, p_index->current_start_pos, range.starts, pos) < 0) {
+    ++p_index->current_start_pos;
+
+    // Past the end? Signal OOB with `last_pos + 1`.
+    if (p_index->current_start_pos > p_index->last_pos) {
+      return p_index->last_pos + 1;
+    }
+  }
+
+  return p_index->current_start_pos;
+}
+
+static int locate_window_stops_pos(struct window_index* p_index, struct window_range range, int pos) {
+  // Pin to the end
+  if (range.stop_unbounded) {
+    return p_index->last_pos;
+  }
+
+  // Past the end? Pin to end.
+  // This also handles size zero `.i` with `.starts` / `.stops` that have size.
+  // Current pos will be 0, but `last_pos` will be -1.
+  if (p_index->current_stop_pos > p_index->last_pos) {
+    return p_index->last_pos;
+  }
+
+  while (p_index->compare(p_index->data, p_index->current_stop_pos, range.stops, pos) <= 0) {
+    ++p_index->current_stop_pos;
+
+    // Past the end? Pin to end.
+    if (p_index->current_stop_pos > p_index->last_pos) {
+      return p_index->last_pos;
+    }
+  }
+
+  return p_index->current_stop_pos - 1;
+}
+
+// Locate the positions in the index of the first and last values that fall
+// in the window at `pos`. Empty windows have `*p_stop_pos < *p_start_pos`.
+// The range must be visited in increasing order of `pos`.
+// [[ include("window.h") ]]
+void window_locate(struct window_index* p_index,
+                   struct window_range range,
+                   int pos,
+                   int* p_start_pos,
+                   int* p_stop_pos) {
+  *p_start_pos = locate_window_starts_pos(p_index, range, pos);
+  *p_stop_pos = locate_window_stops_pos(p_index, range, pos);
+}
+
+// Like `window_locate()`, but with binary searches over the whole index
+// rather than a cursor, so the range can be visited in any order. Each window
+// costs O(log(n)) rather than amortized O(1). Out of bounds windows are
+// reported the same way.
+// [[ include("window.h") ]]
+void window_search(const struct window_index* p_index,
+                   struct window_range range,
+                   int pos,
+                   int* p_start_pos,
+                   int* p_stop_pos) {
+  const window_compare_fn compare = p_index->compare;
+  const void* data = p_index->data;
+
+  if (range.start_unbounded) {
+    *p_start_pos = p_index->first_pos;
+  } else {
+    // The first value that is `>=` the start of the window
+    int lo = p_index->first_pos;
+    int hi = p_index->last_pos + 1;
+
+    while (lo < hi) {
+      const int mid = lo + (hi - lo) / 2;
+
+      if (compare(data, mid, range.starts, pos) < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    *p_start_pos = lo;
+  }
+
+  if (range.stop_unbounded) {
+    *p_stop_pos = p_index->last_pos;
+  } else {
+    // The last value that is `<=` the stop of the window
+    int lo = p_index->first_pos;
+    int hi = p_index->last_pos + 1;
+
+    while (lo < hi) {
+      const int mid = lo + (hi - lo) / 2;
+
+      if (compare(data, mid, range.stops, pos) <= 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    *p_stop_pos = lo - 1;
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+// The 1-based location of the first window of a complete `slide_period()`,
+// which is the first one that doesn't start before `first`
+// [[ include("window.h") ]]
+ptrdiff_t window_compute_from(const double* p_starts,
+                              double first,
+                              ptrdiff_t n,
+                              bool before_unbounded) {
+  ptrdiff_t from = 1;
+
+  if (before_unbounded) {
+    return from;
+  }
+
+  for (ptrdiff_t i = 0; i < n; ++i) {
+    if (first > p_starts[i]) {
+      ++from;
+    } else {
+      break;
+    }
+  }
+
+  return from;
+}
+
+// The 1-based location of the last window of a complete `slide_period()`,
+// which is the last one that doesn't stop after `last`
+// [[ include("window.h") ]]
+ptrdiff_t window_compute_to(const double* p_stops,
+                            double last,
+                            ptrdiff_t n,
+                            bool after_unbounded) {
+  ptrdiff_t to = n;
+
+  if (after_unbounded) {
+    return to;
+  }
+
+  for (ptrdiff_t i = n - 1; i >= 0; --i) {
+    if (last < p_stops[i]) {
+      --to;
+    } else {
+      break;
+    }
+  }
+
+  return to;
+}
@@ -0,0 +1,132 @@
+#ifndef SLIDER_WINDOW_H
+#define SLIDER_WINDOW_H
+
+// -----------------------------------------------------------------------------
+// Window boundary engine
+//
+// Everything declared here is plain C that operates on typed arrays. None of
+// it touches the R API, so it never allocates, signals errors, or checks for
+// interrupts. Problems are reported through `enum window_status` instead, and
+// it is up to the R bindings to turn them into errors. This keeps the
+// boundary computations safe to run off the main R thread, and lets them be
+// compiled and tested on their own.
+//
+// All positions are 0-based.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+enum window_status {
+  WINDOW_OK = 0,
+  WINDOW_ERROR_STEP,
+  WINDOW_ERROR_DOUBLE_NEGATIVE,
+  WINDOW_ERROR_BEFORE_NEGATIVE,
+  WINDOW_ERROR_AFTER_NEGATIVE
+};
+
+// -----------------------------------------------------------------------------
+// Positional windows
+
+// Iteration state of a positional slide, computed from the `.before`,
+// `.after`, `.step`, and `.complete` params. Iteration `i` runs from
+// `iteration_min` to `iteration_max` by `step`, and the unrestricted window
+// boundaries start at `start` / `stop` and move by `start_step` / `stop_step`
+// per iteration.
+struct slide_info {
+  int iteration_min;
+  int iteration_max;
+  int step;
+  int start;
+  int start_step;
+  int stop;
+  int stop_step;
+};
+
+enum window_status slide_info_compute(struct slide_info* p_info,
+                                      int size,
+                                      int before,
+                                      bool before_unbounded,
+                                      int after,
+                                      bool after_unbounded,
+                                      int step,
+                                      bool complete);
+
+int slide_info_n_iterations(struct slide_info info);
+
+int slide_info_fill_windows(struct slide_info info,
+                            int size,
+                            int* p_loc,
+                            int* p_starts,
+                            int* p_stops);
+
+// -----------------------------------------------------------------------------
+// Index windows
+//
+// An index is a sorted vector of unique values, and a range is a pair of
+// vectors of the same type holding the first and last value of each window.
+// The values are opaque to the engine, which only ever compares an element
+// of the index with an element of the range through `compare`, a three-way
+// comparison returning a negative number, zero, or a positive number.
+
+typedef int (*window_compare_fn)(const void* x, int i, const void* y, int j);
+
+int window_compare_int(const void* x, int i, const void* y, int j);
+int window_compare_dbl(const void* x, int i, const void* y, int j);
+
+struct window_index {
+  const void* data;
+  int size;
+  int first_pos;
+  int last_pos;
+  int current_start_pos;
+  int current_stop_pos;
+  window_compare_fn compare;
+};
+
+// `starts` and `stops` are `NULL` for unbounded windows
+struct window_range {
+  const void* starts;
+  const void* stops;
+  int first_pos;
+  int size;
+  bool start_unbounded;
+  bool stop_unbounded;
+};
+
+struct window_index new_window_index(const void* data, int size, window_compare_fn compare);
+struct window_range new_window_range(const void* starts, const void* stops, int size);
+
+void window_restrict(struct window_index* p_index,
+                     struct window_range* p_range,
+                     int from,
+                     int size);
+
+int window_min_iteration(struct window_index index, struct window_range range, bool complete);
+int window_max_iteration(struct window_index index, struct window_range range, bool complete);
+
+void window_locate(struct window_index* p_index,
+                   struct window_range range,
+                   int pos,
+                   int* p_start_pos,
+                   int* p_stop_pos);
+
+void window_search(const struct window_index* p_index,
+                   struct window_range range,
+                   int pos,
+                   int* p_start_pos,
+                   int* p_stop_pos);
+
+// -----------------------------------------------------------------------------
+// Period windows
+
+ptrdiff_t window_compute_from(const double* p_starts,
+                              double first,
+                              ptrdiff_t n,
+                              bool before_unbounded);
+
+ptrdiff_t window_compute_to(const double* p_stops,
+                            double last,
+                            ptrdiff_t n,
+                            bool after_unbounded);
+
+#endif